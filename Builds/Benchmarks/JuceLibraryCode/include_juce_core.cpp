@@ -6,4 +6,4 @@
 */
 
 #include "AppConfig.h"
-#include <juce_video/juce_video.mm>
+#include <juce_core/juce_core.cpp>
@@ -6,4 +6,4 @@
 */
 
 #include "AppConfig.h"
-#include <juce_cryptography/juce_cryptography.mm>
+#include <juce_audio_basics/juce_audio_basics.cpp>
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    Counts heap allocations for HeadlessAudioDevice by replacing malloc(),
+    calloc() and realloc() for the whole process. This works like an
+    LD_PRELOAD shim, but it's linked into the executable instead.
+
+    Everything allocates through these, so as well as operator new it catches
+    HeapBlock, and the Array and AudioSampleBuffer storage built on it, which
+    call the C allocator directly. Each call notes the allocation and goes
+    straight on to glibc's own allocator.
+
+    Only the tests build (Builds/Tests) compiles this file, so the application
+    and the benchmarks allocate exactly as they normally would. It needs glibc.
+    Elsewhere it compiles to nothing, and allocations aren't counted.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "HeadlessAudioDevice.h"
+
+#if JUCE_LINUX && defined (__GLIBC__)
+
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+
+    void* malloc (size_t size) noexcept
+    {
+        HeadlessAudioDevice::noteAllocation();
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t num, size_t size) noexcept
+    {
+        HeadlessAudioDevice::noteAllocation();
+        return __libc_calloc (num, size);
+    }
+
+    void* realloc (void* p, size_t size) noexcept
+    {
+        HeadlessAudioDevice::noteAllocation();
+        return __libc_realloc (p, size);
+    }
+}
+
+#endif
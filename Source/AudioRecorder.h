@@ -0,0 +1,134 @@
+#ifndef AUDIORECORDER_H_INCLUDED
+#define AUDIORECORDER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Writes the audio input to a WAV file.
+
+    The audio thread only copies each block into the ThreadedWriter's FIFO,
+    which is a fixed size, so a recording of any length uses the same memory.
+    A TimeSliceThread drains the FIFO to disk. If the disk falls behind and a
+    block doesn't fit, it's dropped and counted rather than making the audio
+    thread wait. The writer is swapped in and out under a SpinLock that the
+    audio thread only ever try-locks.
+*/
+class AudioRecorder
+{
+public:
+    AudioRecorder()
+       : writerThread ("Audio recorder")
+    {
+    }
+
+    ~AudioRecorder()
+    {
+        stop();
+    }
+
+    //==============================================================================
+    /** Starts writing to the given file, replacing it if it exists. Returns false
+        if the file couldn't be created. */
+    bool startRecording (const File& file, double sampleRate, int numChannels)
+    {
+        stop();
+
+        if (sampleRate <= 0.0 || numChannels <= 0)
+            return false;
+
+        file.deleteFile();
+        ScopedPointer<FileOutputStream> stream (file.createOutputStream());
+
+        if (stream == nullptr)
+            return false;
+
+        WavAudioFormat wavFormat;
+        AudioFormatWriter* writer = wavFormat.createWriterFor (stream, sampleRate,
+                                                               (unsigned int) jmin (numChannels, (int) maxChannels),
+                                                               24, StringPairArray(), 0);
+        if (writer == nullptr)
+            return false;
+
+        stream.release();   // the writer owns it now
+
+        if (! writerThread.isThreadRunning())
+            writerThread.startThread (4);
+
+        ScopedPointer<AudioFormatWriter::ThreadedWriter> newWriter
+            (new AudioFormatWriter::ThreadedWriter (writer, writerThread, fifoSize));
+
+        numChannelsToRecord = jmin (numChannels, (int) maxChannels);
+        numSamplesRecorded.set (0);
+        numBlocksDropped.set (0);
+        recordingFile = file;
+
+        const SpinLock::ScopedLockType lock (writerLock);
+        activeWriter = newWriter;
+        return true;
+    }
+
+    /** Stops recording and finishes writing the file. */
+    void stop()
+    {
+        ScopedPointer<AudioFormatWriter::ThreadedWriter> oldWriter;
+
+        {
+            const SpinLock::ScopedLockType lock (writerLock);
+            oldWriter = activeWriter.release();
+        }
+
+        // deleting the ThreadedWriter flushes whatever is left in its FIFO
+        oldWriter = nullptr;
+    }
+
+    bool isRecording() const noexcept               { return activeWriter != nullptr; }
+    const File& getRecordingFile() const noexcept   { return recordingFile; }
+
+    int64 getNumSamplesRecorded() const noexcept    { return numSamplesRecorded.get(); }
+    int getNumBlocksDropped() const noexcept        { return numBlocksDropped.get(); }
+
+    //==============================================================================
+    /** Called on the audio thread with the incoming audio, before anything has
+        been written over it. */
+    void pushInput (const AudioSampleBuffer& buffer, int startSample, int numSamples) noexcept
+    {
+        const SpinLock::ScopedTryLockType lock (writerLock);
+
+        // the lock is only held while a recording is starting or stopping
+        if (! lock.isLocked() || activeWriter == nullptr)
+            return;
+
+        const float* channels[maxChannels] = {};
+
+        for (int ch = 0; ch < numChannelsToRecord; ++ch)
+            channels[ch] = buffer.getReadPointer (ch % buffer.getNumChannels(), startSample);
+
+        if (activeWriter->write (channels, numSamples))
+            numSamplesRecorded.set (numSamplesRecorded.get() + numSamples);
+        else
+            ++numBlocksDropped;
+    }
+
+private:
+    //==============================================================================
+    enum
+    {
+        fifoSize = 65536,   // samples buffered between the audio thread and the disk
+        maxChannels = 8
+    };
+
+    TimeSliceThread writerThread;
+
+    SpinLock writerLock;
+    ScopedPointer<AudioFormatWriter::ThreadedWriter> activeWriter;
+    int numChannelsToRecord = 0;
+    File recordingFile;
+
+    Atomic<int64> numSamplesRecorded;
+    Atomic<int> numBlocksDropped;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioRecorder)
+};
+
+#endif  // AUDIORECORDER_H_INCLUDED
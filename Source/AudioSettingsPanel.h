@@ -0,0 +1,266 @@
+#ifndef AUDIOSETTINGSPANEL_H_INCLUDED
+#define AUDIOSETTINGSPANEL_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameScheduler.h"
+#include "HotSwapAudioSource.h"
+#include "LatencyMonitor.h"
+#include "PlayheadClock.h"
+#include "ProcessingChain.h"
+#include "Tracer.h"
+
+//==============================================================================
+/*
+    Sets the crossfade used when a new file is opened during playback.
+*/
+class CrossfadeSettingsSection : public Component,
+                                 private Slider::Listener
+{
+public:
+    CrossfadeSettingsSection (HotSwapAudioSource& playbackSlotToUse)
+       : playbackSlot (playbackSlotToUse)
+    {
+        addAndMakeVisible (&crossfadeSlider);
+        crossfadeSlider.setRange (0.0, 1000.0, 10.0);
+        crossfadeSlider.setValue (playbackSlot.getCrossfadeMs(), dontSendNotification);
+        crossfadeSlider.setTextValueSuffix (" ms");
+        crossfadeSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 80, crossfadeSlider.getTextBoxHeight());
+        crossfadeSlider.addListener (this);
+
+        addAndMakeVisible (&crossfadeLabel);
+        crossfadeLabel.setText ("File switch crossfade", dontSendNotification);
+        crossfadeLabel.attachToComponent (&crossfadeSlider, true);
+
+        setSize (480, 24);
+    }
+
+    void resized() override
+    {
+        crossfadeSlider.setBounds (getLocalBounds().withTrimmedLeft (150));
+    }
+
+private:
+    void sliderValueChanged (Slider*) override
+    {
+        playbackSlot.setCrossfadeMs (roundToInt (crossfadeSlider.getValue()));
+    }
+
+    HotSwapAudioSource& playbackSlot;
+    Label crossfadeLabel;
+    Slider crossfadeSlider;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CrossfadeSettingsSection)
+};
+
+//==============================================================================
+/*
+    Starts recording a trace of what every thread is doing, and saves it to
+    a new file in the same folder as recordings, for opening in
+    chrome://tracing or Perfetto.
+*/
+class TraceSettingsSection : public Component,
+                             private ButtonListener
+{
+public:
+    TraceSettingsSection()
+    {
+        addAndMakeVisible (&traceButton);
+        traceButton.setButtonText (Tracer::isEnabled() ? "Save trace" : "Start trace");
+        traceButton.addListener (this);
+
+        addAndMakeVisible (&resultLabel);
+        resultLabel.setFont (Font (13.0f));
+
+        setSize (480, 24);
+    }
+
+    void resized() override
+    {
+        Rectangle<int> area (getLocalBounds());
+        traceButton.setBounds (area.removeFromRight (140));
+        area.removeFromRight (10);
+        resultLabel.setBounds (area);
+    }
+
+private:
+    void buttonClicked (Button*) override
+    {
+        Tracer& tracer = Tracer::getInstance();
+
+        if (! Tracer::isEnabled())
+        {
+            tracer.start();
+            traceButton.setButtonText ("Save trace");
+            return;
+        }
+
+        tracer.stop();
+        traceButton.setButtonText ("Start trace");
+
+        const File file (File::getSpecialLocation (File::userDocumentsDirectory)
+                             .getChildFile (ProjectInfo::projectName)
+                             .getNonexistentChildFile ("Trace", ".json"));
+        file.getParentDirectory().createDirectory();
+
+        resultLabel.setText (tracer.writeTo (file) ? "Trace saved to " + file.getFullPathName()
+                                                   : "Couldn't save the trace to " + file.getFullPathName(),
+                             dontSendNotification);
+    }
+
+    TextButton traceButton;
+    Label resultLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TraceSettingsSection)
+};
+
+//==============================================================================
+/*
+    Lets the user pick the audio backend (ALSA / JACK on Linux), output device,
+    sample rate and buffer size, and shows what's being measured for the
+    current setup: the latency and callback jitter from the LatencyMonitor,
+    how far the drawn playhead is from the audio, how many display frames
+    were dropped and what each effect in the chain costs.
+
+    Settings that belong to other features are added with addSection(), and
+    are stacked underneath in the order they were added.
+
+    Input channels are hidden: the app runs the device in playback-only mode.
+*/
+class AudioSettingsPanel : public Component,
+                           private ButtonListener,
+                           private ChangeListener,
+                           private Timer
+{
+public:
+    AudioSettingsPanel (AudioDeviceManager& deviceManagerToUse, LatencyMonitor& monitorToUse,
+                        PlayheadClock& playheadClockToUse, ProcessingChain& chainToUse,
+                        FrameScheduler& frameSchedulerToUse)
+       : deviceManager (deviceManagerToUse),
+         monitor (monitorToUse),
+         playheadClock (playheadClockToUse),
+         processingChain (chainToUse),
+         frameScheduler (frameSchedulerToUse),
+         deviceSelector (deviceManagerToUse,
+                         0, 0,           // no input channels
+                         1, 2,           // mono or stereo output
+                         false, false,   // no MIDI
+                         true,           // stereo pairs
+                         false)          // always show buffer size / sample rate
+    {
+        addAndMakeVisible (&deviceSelector);
+
+        addAndMakeVisible (&statsLabel);
+        statsLabel.setFont (Font (Font::getDefaultMonospacedFontName(), 13.0f, Font::plain));
+        statsLabel.setJustificationType (Justification::topLeft);
+
+        addAndMakeVisible (&resetButton);
+        resetButton.setButtonText ("Reset statistics");
+        resetButton.addListener (this);
+
+        deviceManager.addChangeListener (this);
+
+        setSize (500, 470);
+        updateStats();
+        startTimer (250);
+    }
+
+    ~AudioSettingsPanel()
+    {
+        deviceManager.removeChangeListener (this);
+    }
+
+    /** Adds a component underneath the statistics, and makes the panel taller
+        by its height. The panel takes ownership of it. */
+    void addSection (Component* newSection)
+    {
+        sections.add (newSection);
+        addAndMakeVisible (newSection);
+        setSize (getWidth(), getHeight() + newSection->getHeight() + sectionGap);
+    }
+
+    void resized() override
+    {
+        Rectangle<int> area (getLocalBounds().reduced (10));
+
+        for (int i = sections.size(); --i >= 0;)
+        {
+            Component* const section = sections.getUnchecked (i);
+            section->setBounds (area.removeFromBottom (section->getHeight()));
+            area.removeFromBottom (sectionGap);
+        }
+
+        resetButton.setBounds (area.removeFromBottom (24).removeFromRight (140));
+        area.removeFromBottom (sectionGap);
+        statsLabel.setBounds (area.removeFromBottom (136));
+
+        deviceSelector.setBounds (area);
+    }
+
+private:
+    enum { sectionGap = 6 };
+
+    void buttonClicked (Button*) override
+    {
+        monitor.resetStatistics();
+        playheadClock.resetStatistics();
+        processingChain.resetProfiles();
+        frameScheduler.resetStatistics();
+    }
+
+    void changeListenerCallback (ChangeBroadcaster*) override
+    {
+        // a new device or buffer size invalidates the old figures
+        monitor.resetStatistics();
+        playheadClock.resetStatistics();
+        processingChain.resetProfiles();
+        updateStats();
+    }
+
+    void timerCallback() override
+    {
+        updateStats();
+    }
+
+    void updateStats()
+    {
+        AudioIODevice* device = deviceManager.getCurrentAudioDevice();
+
+        if (device == nullptr)
+        {
+            statsLabel.setText ("No audio device open", dontSendNotification);
+            return;
+        }
+
+        const LatencyMonitor::Stats stats = monitor.getStats (device);
+
+        String text;
+        text << device->getTypeName() << ": " << device->getName() << newLine
+             << String (stats.sampleRate, 0) << " Hz, " << stats.bufferSize << " samples, output latency "
+             << String (stats.outputLatencyMs, 2) << " ms" << newLine
+             << "callback jitter " << String (stats.meanJitterMs, 3) << " ms mean, "
+             << String (stats.maxJitterMs, 3) << " ms max" << newLine
+             << stats.lateCallbacks << " late of " << stats.numCallbacks << " callbacks" << newLine
+             << "playhead error " << String (playheadClock.getMeanErrorMs(), 3) << " ms mean, "
+             << String (playheadClock.getMaxErrorMs(), 3) << " ms max" << newLine
+             << frameScheduler.getStatistics() << newLine
+             << processingChain.getProfileDescription();
+
+        statsLabel.setText (text, dontSendNotification);
+    }
+
+    //==========================================================================
+    AudioDeviceManager& deviceManager;
+    LatencyMonitor& monitor;
+    PlayheadClock& playheadClock;
+    ProcessingChain& processingChain;
+    FrameScheduler& frameScheduler;
+
+    AudioDeviceSelectorComponent deviceSelector;
+    Label statsLabel;
+    TextButton resetButton;
+    OwnedArray<Component> sections;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioSettingsPanel)
+};
+
+#endif  // AUDIOSETTINGSPANEL_H_INCLUDED
@@ -0,0 +1,133 @@
+#ifndef BENCHMARKS_H_INCLUDED
+#define BENCHMARKS_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    The parts of the benchmark suite that only need the audio formats: how
+    fast a file decodes, and how long an AudioThumbnail takes to build from it.
+
+    Like the other benchmarks, each returns a line of key=value pairs starting
+    with the name of what was measured, so the output of two builds can be
+    compared line by line.
+*/
+namespace Benchmarks
+{
+    /** Writes a stereo test file in the given format: a chord with a little
+        noise, so that compressed formats have something realistic to work on. */
+    inline bool writeTestFile (AudioFormat& format, const File& file, double sampleRate,
+                               double seconds, int bitsPerSample)
+    {
+        file.deleteFile();
+        ScopedPointer<FileOutputStream> stream (file.createOutputStream());
+
+        if (stream == nullptr)
+            return false;
+
+        ScopedPointer<AudioFormatWriter> writer (format.createWriterFor (stream, sampleRate, 2, bitsPerSample,
+                                                                         StringPairArray(), 5));
+        if (writer == nullptr)
+            return false;
+
+        stream.release();   // the writer owns it now
+
+        const int64 length = (int64) (sampleRate * seconds);
+        const double frequencies[] = { 220.0, 277.18, 329.63 };
+
+        AudioSampleBuffer block (2, 8192);
+        Random random (1);
+
+        for (int64 pos = 0; pos < length; pos += block.getNumSamples())
+        {
+            const int num = (int) jmin ((int64) block.getNumSamples(), length - pos);
+
+            for (int i = 0; i < num; ++i)
+            {
+                const double t = (pos + i) / sampleRate;
+                float sample = (random.nextFloat() - 0.5f) * 0.02f;
+
+                for (int n = 0; n < numElementsInArray (frequencies); ++n)
+                    sample += 0.2f * (float) std::sin (2.0 * double_Pi * frequencies[n] * t);
+
+                block.setSample (0, i, sample);
+                block.setSample (1, i, sample * 0.8f);
+            }
+
+            if (! writer->writeFromAudioSampleBuffer (block, 0, num))
+                return false;
+        }
+
+        return true;
+    }
+
+    inline String getFormatKey (const File& file)
+    {
+        return file.getFileExtension().substring (1).toLowerCase();
+    }
+
+    /** Reads the whole file, a block at a time, through a fresh reader. */
+    inline String benchmarkDecode (AudioFormatManager& formatManager, const File& file)
+    {
+        ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+        if (reader == nullptr)
+            return "decode format=" + getFormatKey (file) + " error=cannot_open_file" + newLine;
+
+        AudioSampleBuffer block ((int) reader->numChannels, 65536);
+        const int64 start = Time::getHighResolutionTicks();
+
+        for (int64 pos = 0; pos < reader->lengthInSamples; pos += block.getNumSamples())
+            reader->read (&block, 0, (int) jmin ((int64) block.getNumSamples(), reader->lengthInSamples - pos),
+                          pos, true, true);
+
+        const double seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+        const double audioSeconds = reader->lengthInSamples / reader->sampleRate;
+
+        String result;
+        result << "decode format=" << getFormatKey (file)
+               << " channels=" << (int) reader->numChannels
+               << " audio_seconds=" << String (audioSeconds, 1)
+               << " seconds=" << String (seconds, 4)
+               << " msamples_per_second=" << String (reader->lengthInSamples / jmax (1.0e-9, seconds) / 1.0e6, 2)
+               << " realtime_factor=" << String (audioSeconds / jmax (1.0e-9, seconds), 1)
+               << newLine;
+        return result;
+    }
+
+    /** Builds a thumbnail of the file the way the app does, on the thumbnail
+        cache's thread, and times how long until it's complete. */
+    inline String benchmarkThumbnail (AudioFormatManager& formatManager, const File& file)
+    {
+        AudioFormatReader* reader = formatManager.createReaderFor (file);
+
+        if (reader == nullptr)
+            return "thumbnail format=" + getFormatKey (file) + " error=cannot_open_file" + newLine;
+
+        const double audioSeconds = reader->lengthInSamples / reader->sampleRate;
+
+        AudioThumbnailCache cache (1);
+        AudioThumbnail thumbnail (512, formatManager, cache);
+
+        // a fresh hash, so nothing is loaded from the cache
+        const int64 start = Time::getHighResolutionTicks();
+        thumbnail.setReader (reader, Random::getSystemRandom().nextInt64());
+
+        while (! thumbnail.isFullyLoaded()
+                 && Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start) < 120.0)
+            Thread::sleep (1);
+
+        const double seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+
+        String result;
+        result << "thumbnail format=" << getFormatKey (file)
+               << " audio_seconds=" << String (audioSeconds, 1)
+               << " seconds=" << String (seconds, 4)
+               << " realtime_factor=" << String (audioSeconds / jmax (1.0e-9, seconds), 1)
+               << " complete=" << (thumbnail.isFullyLoaded() ? "yes" : "no")
+               << newLine;
+        return result;
+    }
+}
+
+#endif  // BENCHMARKS_H_INCLUDED
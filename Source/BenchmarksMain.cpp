@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    The entry point of the benchmarks build (Builds/Benchmarks). It's a console
+    app of its own, so the numbers don't include the GUI application's startup.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "CommandLineHarness.h"
+#include "Benchmarks.h"
+#include "ParametricEq.h"
+#include "WaveformRasterizer.h"
+
+using CommandLineHarness::getOptionValue;
+using CommandLineHarness::playThroughHeadlessDevice;
+
+//==============================================================================
+// Paints the whole window off-screen, with a file loaded and stopped, the
+// way it's painted on each timer tick.
+static String benchmarkComponentPaint (const File& file)
+{
+    MainContentComponent content;
+
+    if (! content.loadFileHeadless (file))
+        return String ("paint view=window error=cannot_open_file") + newLine;
+
+    const int64 start = Time::getHighResolutionTicks();
+
+    while (! content.isThumbnailFullyLoaded()
+             && Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start) < 120.0)
+        Thread::sleep (1);
+
+    const int widths[] = { 600, 1280, 1920, 2560, 3840 };
+    const int height = 600, numFrames = 30;
+    String results;
+
+    for (int w = 0; w < numElementsInArray (widths); ++w)
+    {
+        content.setSize (widths[w], height);
+
+        Image target (Image::ARGB, widths[w], height, true);
+        Graphics g (target);
+        content.paintEntireComponent (g, true);     // not timed: fills the caches
+
+        const int64 paintStart = Time::getHighResolutionTicks();
+
+        for (int frame = 0; frame < numFrames; ++frame)
+            content.paintEntireComponent (g, true);
+
+        const double seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - paintStart);
+
+        results << "paint view=window width=" << widths[w] << " height=" << height
+                << " frame_us=" << String (seconds * 1.0e6 / numFrames, 1) << newLine;
+    }
+
+    return results;
+}
+
+/*  Runs every benchmark and returns a line of key=value pairs per result:
+
+        --all [<file>]
+
+    Decoding and thumbnail building are timed for the file, or for a minute
+    of generated audio as WAV and FLAC if none is given. The callback is
+    timed at a range of block sizes, playing the first of those files, and
+    painting at a range of window widths.
+*/
+static String runBenchmarkSuite (const StringArray& args)
+{
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    const String path (getOptionValue (args, "--all", String()));
+    const TemporaryFile wavFile (".wav"), flacFile (".flac");
+    Array<File> files;
+
+    if (path.isNotEmpty() && ! path.startsWith ("--"))
+    {
+        files.add (File::getCurrentWorkingDirectory().getChildFile (path));
+    }
+    else
+    {
+        WavAudioFormat wavFormat;
+        FlacAudioFormat flacFormat;
+
+        if (Benchmarks::writeTestFile (wavFormat, wavFile.getFile(), 44100.0, 60.0, 16))
+            files.add (wavFile.getFile());
+
+        if (Benchmarks::writeTestFile (flacFormat, flacFile.getFile(), 44100.0, 60.0, 16))
+            files.add (flacFile.getFile());
+    }
+
+    if (files.isEmpty() || ! files.getFirst().existsAsFile())
+        return String ("benchmark error=no_input_file") + newLine;
+
+    String results;
+    results << "benchmark version=" << ProjectInfo::versionString
+            << " juce=" << SystemStats::getJUCEVersion().replaceCharacter (' ', '_')
+            << " cpus=" << SystemStats::getNumCpus() << newLine;
+
+    for (int i = 0; i < files.size(); ++i)
+        results << Benchmarks::benchmarkDecode (formatManager, files.getReference (i))
+                << Benchmarks::benchmarkThumbnail (formatManager, files.getReference (i));
+
+    const int blockSizes[] = { 64, 128, 256, 512, 1024, 2048 };
+
+    for (int i = 0; i < numElementsInArray (blockSizes); ++i)
+    {
+        HeadlessAudioDevice device (44100.0, blockSizes[i]);
+        AudioSampleBuffer output (2, (30 * 44100 / blockSizes[i]) * blockSizes[i]);
+
+        if (playThroughHeadlessDevice (files.getFirst(), device, output))
+            results << device.getReport() << newLine;
+    }
+
+    results << WaveformRasterizer::runBenchmark()
+            << benchmarkComponentPaint (files.getFirst())
+            << ParametricEqProcessor::runBenchmark();
+
+    return results;
+}
+
+//==============================================================================
+static const char* const usage =
+    "Usage: AudioThumbnailBenchmarks [--all [<file>] | --eq | --paint]\n"
+    "\n"
+    "  --all [<file>]   run every benchmark, on the file or on generated audio\n"
+    "  --eq             time the parametric EQ\n"
+    "  --paint          time the waveform rasterizer\n";
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the playback path is built from components, so it needs a message manager
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (CharPointer_UTF8 (argv[i]));
+
+    if (args.isEmpty() || args.contains ("--all"))
+    {
+        std::cout << runBenchmarkSuite (args) << std::flush;
+        return 0;
+    }
+
+    if (args.contains ("--eq"))
+    {
+        std::cout << ParametricEqProcessor::runBenchmark() << std::flush;
+        return 0;
+    }
+
+    if (args.contains ("--paint"))
+    {
+        std::cout << WaveformRasterizer::runBenchmark() << std::flush;
+        return 0;
+    }
+
+    std::cerr << usage;
+    return 1;
+}
@@ -0,0 +1,514 @@
+#ifndef CHROMAGRAM_H_INCLUDED
+#define CHROMAGRAM_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DecodedBlockCache.h"
+#include "Tracer.h"
+#include <complex>
+
+//==============================================================================
+/*
+    Works out how much of each of the twelve pitch classes (C, C#, D ... B) is
+    sounding over time, for drawing a chromagram lane under the waveform.
+
+    Each frame is a Hann-windowed FFT of the mono mix. The power of every bin
+    between 50 Hz and 5 kHz is added to the pitch class nearest its frequency,
+    and the twelve totals are scaled so that the strongest is 1. Quiet frames
+    are left empty rather than showing the noise floor.
+
+    The FFT is a plain radix-2 one, since the DSP module isn't part of this
+    project.
+*/
+namespace Chroma
+{
+    enum
+    {
+        numPitchClasses = 12,
+        fftOrder = 12,
+        fftSize = 1 << fftOrder,
+        hopSize = fftSize / 2
+    };
+
+    inline const char* getPitchClassName (int pitchClass) noexcept
+    {
+        static const char* const names[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+        return names[pitchClass % numPitchClasses];
+    }
+
+    //==============================================================================
+    /** Turns blocks of fftSize samples into pitch class profiles. Each thread
+        doing analysis needs one of these of its own. */
+    class FrameAnalyser
+    {
+    public:
+        FrameAnalyser (double sampleRate)
+            : window ((size_t) fftSize), buffer ((size_t) fftSize), twiddles ((size_t) fftSize / 2),
+              bitReversed ((size_t) fftSize), pitchClassOfBin ((size_t) fftSize / 2)
+        {
+            for (int i = 0; i < fftSize; ++i)
+            {
+                window[(size_t) i] = 0.5f - 0.5f * std::cos (2.0f * float_Pi * i / (fftSize - 1));
+
+                int reversed = 0;
+
+                for (int bit = 0; bit < fftOrder; ++bit)
+                    reversed |= ((i >> bit) & 1) << (fftOrder - 1 - bit);
+
+                bitReversed[(size_t) i] = reversed;
+            }
+
+            for (int i = 0; i < fftSize / 2; ++i)
+                twiddles[(size_t) i] = std::polar (1.0f, -2.0f * float_Pi * i / fftSize);
+
+            for (int bin = 0; bin < fftSize / 2; ++bin)
+            {
+                const double frequency = bin * sampleRate / fftSize;
+
+                if (frequency < 50.0 || frequency > 5000.0)
+                {
+                    pitchClassOfBin[(size_t) bin] = -1;
+                    continue;
+                }
+
+                const int midiNote = roundToInt (69.0 + 12.0 * std::log2 (frequency / 440.0));
+                pitchClassOfBin[(size_t) bin] = ((midiNote % numPitchClasses) + numPitchClasses) % numPitchClasses;
+            }
+        }
+
+        /** Analyses fftSize samples, writing twelve values from 0 to 255. */
+        void analyse (const float* samples, uint8* profile) noexcept
+        {
+            for (int i = 0; i < fftSize; ++i)
+                buffer[(size_t) bitReversed[(size_t) i]] = std::complex<float> (samples[i] * window[(size_t) i], 0.0f);
+
+            performFft();
+
+            float energy[numPitchClasses] = {};
+            float total = 0.0f;
+
+            for (int bin = 1; bin < fftSize / 2; ++bin)
+            {
+                const int pitchClass = pitchClassOfBin[(size_t) bin];
+
+                if (pitchClass >= 0)
+                {
+                    const float power = std::norm (buffer[(size_t) bin]);
+                    energy[pitchClass] += power;
+                    total += power;
+                }
+            }
+
+            const float strongest = *std::max_element (energy, energy + numPitchClasses);
+
+            // about -60 dBFS for a sine, over the window
+            const float silence = fftSize * fftSize * 1.0e-7f;
+
+            for (int i = 0; i < numPitchClasses; ++i)
+                profile[i] = total > silence ? (uint8) jlimit (0, 255, roundToInt (255.0f * energy[i] / strongest)) : 0;
+        }
+
+    private:
+        void performFft() noexcept
+        {
+            for (int size = 2; size <= fftSize; size *= 2)
+            {
+                const int half = size / 2;
+                const int twiddleStep = fftSize / size;
+
+                for (int start = 0; start < fftSize; start += size)
+                {
+                    for (int i = 0; i < half; ++i)
+                    {
+                        const std::complex<float> t = twiddles[(size_t) (i * twiddleStep)] * buffer[(size_t) (start + i + half)];
+                        buffer[(size_t) (start + i + half)] = buffer[(size_t) (start + i)] - t;
+                        buffer[(size_t) (start + i)] += t;
+                    }
+                }
+            }
+        }
+
+        std::vector<float> window;
+        std::vector<std::complex<float>> buffer, twiddles;
+        std::vector<int> bitReversed, pitchClassOfBin;
+
+        JUCE_DECLARE_NON_COPYABLE (FrameAnalyser)
+    };
+}
+
+//==============================================================================
+/*
+    The chromagram of a whole file, filled in by background jobs.
+
+    The frames are split into chunks that are analysed in parallel. Each
+    chunk is flagged once it's finished, so the lane can be drawn while the
+    analysis is still running.
+*/
+class Chromagram : public ReferenceCountedObject
+{
+public:
+    typedef ReferenceCountedObjectPtr<Chromagram> Ptr;
+
+    Chromagram (double fileSampleRate, int64 fileLength)
+        : sampleRate (fileSampleRate),
+          numFrames ((int) jmax ((int64) 0, (fileLength - Chroma::fftSize) / Chroma::hopSize + 1)),
+          values ((size_t) numFrames * Chroma::numPitchClasses, true)
+    {
+        for (int first = 0; first < numFrames; first += framesPerChunk)
+            chunks.add (new Chunk (first, jmin ((int) framesPerChunk, numFrames - first)));
+    }
+
+    double getSecondsPerFrame() const noexcept      { return Chroma::hopSize / sampleRate; }
+    int getNumFrames() const noexcept               { return numFrames; }
+
+    /** Returns the frame's twelve values (0 to 255), or nullptr if it hasn't
+        been analysed yet. */
+    const uint8* getFrame (int frame) const noexcept
+    {
+        if (! isPositiveAndBelow (frame, numFrames) || chunks.getUnchecked (frame / framesPerChunk)->done.get() == 0)
+            return nullptr;
+
+        return values + (size_t) frame * Chroma::numPitchClasses;
+    }
+
+    /** Returns the proportion of the file that has been analysed. */
+    double getProgress() const noexcept
+    {
+        return chunks.size() > 0 ? numChunksDone.get() / (double) chunks.size() : 1.0;
+    }
+
+    /** Returns true if the file couldn't be read, in which case the analysis
+        will never finish. */
+    bool hasFailed() const noexcept                 { return failed.get() != 0; }
+
+    /** Draws the frames between two times as a row per pitch class, C at the
+        bottom, each in its own hue and brighter the stronger it is. Frames
+        that haven't been analysed yet are left blank. */
+    void draw (Graphics& g, const Rectangle<int>& area, double startTime, double endTime) const
+    {
+        if (area.isEmpty() || endTime <= startTime)
+            return;
+
+        Graphics::ScopedSaveState state (g);
+        g.reduceClipRegion (area);
+
+        const double secondsPerFrame = getSecondsPerFrame();
+        const double pixelsPerSecond = area.getWidth() / (endTime - startTime);
+        const float frameWidth = (float) (secondsPerFrame * pixelsPerSecond);
+        const float rowHeight = area.getHeight() / (float) Chroma::numPitchClasses;
+
+        // a frame is drawn centred on the middle of its window
+        const double offset = (Chroma::fftSize - Chroma::hopSize) * 0.5 / sampleRate;
+        const int firstFrame = jmax (0, (int) ((startTime - offset) / secondsPerFrame));
+        const int lastFrame = jmin (numFrames - 1, (int) ((endTime - offset) / secondsPerFrame));
+
+        for (int frame = firstFrame; frame <= lastFrame; ++frame)
+        {
+            const uint8* profile = getFrame (frame);
+
+            if (profile == nullptr)
+                continue;
+
+            const float x = (float) (area.getX() + (frame * secondsPerFrame + offset - startTime) * pixelsPerSecond);
+
+            for (int pitchClass = 0; pitchClass < Chroma::numPitchClasses; ++pitchClass)
+            {
+                if (profile[pitchClass] == 0)
+                    continue;
+
+                g.setColour (Colour::fromHSV (pitchClass / (float) Chroma::numPitchClasses, 0.7f,
+                                              profile[pitchClass] / 255.0f, 1.0f));
+                g.fillRect (Rectangle<float> (x, area.getBottom() - (pitchClass + 1) * rowHeight,
+                                              frameWidth, rowHeight));
+            }
+        }
+    }
+
+private:
+    friend class ChromagramCache;
+
+    enum { framesPerChunk = 128 };
+
+    struct Chunk
+    {
+        Chunk (int first, int num) : firstFrame (first), numFrames (num) {}
+
+        const int firstFrame, numFrames;
+        Atomic<int> done;
+    };
+
+    const double sampleRate;
+    const int numFrames;
+    HeapBlock<uint8> values;
+    OwnedArray<Chunk> chunks;
+    Atomic<int> numChunksDone, failed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Chromagram)
+};
+
+//==============================================================================
+/*
+    Keeps the chromagrams of the last few files, keyed the same way as the
+    thumbnail cache, and analyses new ones on a pool of background threads.
+    Each job opens its own uncached reader, so the chunks decode in parallel
+    and a whole-file pass doesn't evict the blocks that playback is using.
+*/
+class ChromagramCache
+{
+public:
+    ChromagramCache (DecodedBlockCache& cacheToReadFrom, int maxFilesToKeep)
+       : blockCache (cacheToReadFrom),
+         maxFiles (maxFilesToKeep),
+         pool (jlimit (1, 4, SystemStats::getNumCpus() - 1))
+    {
+    }
+
+    ~ChromagramCache()
+    {
+        pool.removeAllJobs (true, 5000);
+    }
+
+    /** Returns the chromagram for a file, starting its analysis if it isn't
+        already known. Returns nullptr if the file can't be read. */
+    Chromagram::Ptr getChromagramFor (const File& file, int64 hash)
+    {
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            if (entries.getReference (i).hash == hash)
+            {
+                // move it to the back, as the most recently used
+                const Entry entry (entries.removeAndReturn (i));
+                entries.add (entry);
+                return entry.chromagram;
+            }
+        }
+
+        ScopedPointer<AudioFormatReader> reader (blockCache.createReaderFor (file));
+
+        if (reader == nullptr || reader->sampleRate <= 0.0)
+            return nullptr;
+
+        Chromagram::Ptr chromagram (new Chromagram (reader->sampleRate, reader->lengthInSamples));
+
+        for (int i = 0; i < chromagram->chunks.size(); ++i)
+            pool.addJob (new ChunkJob (blockCache, file, chromagram, *chromagram->chunks.getUnchecked (i)), true);
+
+        const Entry entry = { hash, chromagram };
+        entries.add (entry);
+
+        while (entries.size() > maxFiles)
+            forget (entries.removeAndReturn (0).chromagram);
+
+        return chromagram;
+    }
+
+private:
+    //==============================================================================
+    class ChunkJob : public ThreadPoolJob
+    {
+    public:
+        ChunkJob (DecodedBlockCache& c, const File& f, Chromagram* g, Chromagram::Chunk& ch)
+            : ThreadPoolJob ("Chromagram"), blockCache (c), file (f), chromagram (g), chunk (ch)
+        {
+        }
+
+        Chromagram* getChromagram() const noexcept      { return chromagram; }
+
+        JobStatus runJob() override
+        {
+            TRACE_SCOPE ("Chromagram chunk");
+
+            ScopedPointer<AudioFormatReader> reader (blockCache.createUncachedReaderFor (file));
+
+            if (reader == nullptr)
+            {
+                chromagram->failed.set (1);
+                return jobHasFinished;
+            }
+
+            // one read covers every window in the chunk
+            const int numSamples = (chunk.numFrames - 1) * Chroma::hopSize + Chroma::fftSize;
+            AudioSampleBuffer samples ((int) reader->numChannels, numSamples);
+            reader->read (&samples, 0, numSamples, (int64) chunk.firstFrame * Chroma::hopSize, true, true);
+
+            for (int ch = 1; ch < samples.getNumChannels(); ++ch)
+                samples.addFrom (0, 0, samples, ch, 0, numSamples);
+
+            Chroma::FrameAnalyser analyser (reader->sampleRate);
+
+            for (int i = 0; i < chunk.numFrames; ++i)
+            {
+                if (shouldExit())
+                    return jobHasFinished;
+
+                analyser.analyse (samples.getReadPointer (0, i * Chroma::hopSize),
+                                  chromagram->values + (size_t) (chunk.firstFrame + i) * Chroma::numPitchClasses);
+            }
+
+            chunk.done.set (1);
+            ++(chromagram->numChunksDone);
+            return jobHasFinished;
+        }
+
+    private:
+        DecodedBlockCache& blockCache;
+        const File file;
+        const Chromagram::Ptr chromagram;
+        Chromagram::Chunk& chunk;
+    };
+
+    struct Entry
+    {
+        int64 hash;
+        Chromagram::Ptr chromagram;
+    };
+
+    // Cancels any jobs still working on a chromagram that has been dropped.
+    void forget (Chromagram* chromagram)
+    {
+        for (int i = pool.getNumJobs(); --i >= 0;)
+            if (ChunkJob* job = dynamic_cast<ChunkJob*> (pool.getJob (i)))
+                if (job->getChromagram() == chromagram)
+                    pool.removeJob (job, true, 0);
+    }
+
+    //==============================================================================
+    DecodedBlockCache& blockCache;
+    const int maxFiles;
+    ThreadPool pool;
+    Array<Entry> entries;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChromagramCache)
+};
+
+//==============================================================================
+/*
+    A chromagram of what's being played right now.
+
+    The audio thread pushes the output into a lock-free ring. update(), called
+    from the GUI's timer, analyses the latest fftSize samples each time another
+    hop's worth has arrived and keeps a smoothed profile of them.
+*/
+class LiveChromaAnalyser
+{
+public:
+    LiveChromaAnalyser()
+       : fifo (ringSize)
+    {
+        ring.setSize (1, ringSize);
+        history.setSize (1, Chroma::fftSize);
+    }
+
+    /** Called on the message thread, before the device starts. */
+    void prepare (double sampleRate)
+    {
+        if (sampleRate != preparedRate)
+        {
+            preparedRate = sampleRate;
+            analyser = new Chroma::FrameAnalyser (sampleRate);
+        }
+    }
+
+    /** Called on the audio thread with the samples being played. */
+    void pushSamples (const AudioSampleBuffer& buffer, int startSample, int numSamples) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+        const float gain = 1.0f / jmax (1, buffer.getNumChannels());
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            if (size1 > 0)
+                mixInto (start1, buffer, ch, startSample, size1, ch == 0, gain);
+
+            if (size2 > 0)
+                mixInto (start2, buffer, ch, startSample + size1, size2, ch == 0, gain);
+        }
+
+        fifo.finishedWrite (size1 + size2);
+    }
+
+    /** Analyses whatever has arrived since the last call. */
+    void update()
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+
+        appendToHistory (ring.getReadPointer (0, start1), size1);
+        appendToHistory (ring.getReadPointer (0, start2), size2);
+
+        fifo.finishedRead (size1 + size2);
+    }
+
+    /** Returns the smoothed strength of a pitch class, from 0 to 1. */
+    float getLevel (int pitchClass) const noexcept      { return levels[pitchClass]; }
+
+    /** Returns the strongest pitch class, or -1 if nothing much is sounding. */
+    int getDominantPitchClass() const noexcept
+    {
+        const float* strongest = std::max_element (levels, levels + Chroma::numPitchClasses);
+        return *strongest > 0.5f ? (int) (strongest - levels) : -1;
+    }
+
+private:
+    enum { ringSize = 16384 };
+
+    void mixInto (int ringStart, const AudioSampleBuffer& buffer, int channel, int bufferStart,
+                  int num, bool replace, float gain) noexcept
+    {
+        const float* source = buffer.getReadPointer (channel, bufferStart);
+
+        if (replace)
+            ring.copyFrom (0, ringStart, source, num, gain);
+        else
+            ring.addFrom (0, ringStart, source, num, gain);
+    }
+
+    void appendToHistory (const float* samples, int num)
+    {
+        while (num > 0)
+        {
+            const int n = jmin (num, (int) Chroma::hopSize - numSinceLastFrame);
+
+            // shift the history along and put the new samples at the end
+            float* data = history.getWritePointer (0);
+            memmove (data, data + n, sizeof (float) * (size_t) (Chroma::fftSize - n));
+            memcpy (data + Chroma::fftSize - n, samples, sizeof (float) * (size_t) n);
+
+            samples += n;
+            num -= n;
+            numSinceLastFrame += n;
+
+            if (numSinceLastFrame == Chroma::hopSize)
+            {
+                numSinceLastFrame = 0;
+                analyseHistory();
+            }
+        }
+    }
+
+    void analyseHistory()
+    {
+        if (analyser == nullptr)
+            return;
+
+        uint8 profile[Chroma::numPitchClasses];
+        analyser->analyse (history.getReadPointer (0), profile);
+
+        for (int i = 0; i < Chroma::numPitchClasses; ++i)
+            levels[i] += (profile[i] / 255.0f - levels[i]) * 0.5f;
+    }
+
+    AbstractFifo fifo;
+    AudioSampleBuffer ring, history;
+
+    // only touched by the message thread
+    ScopedPointer<Chroma::FrameAnalyser> analyser;
+    double preparedRate = 0.0;
+    int numSinceLastFrame = 0;
+    float levels[Chroma::numPitchClasses] = {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LiveChromaAnalyser)
+};
+
+#endif  // CHROMAGRAM_H_INCLUDED
@@ -0,0 +1,48 @@
+#ifndef COMMANDLINEHARNESS_H_INCLUDED
+#define COMMANDLINEHARNESS_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MainComponent.h"
+#include "HeadlessAudioDevice.h"
+
+//==============================================================================
+/*
+    The parts the tests (Builds/Tests) and benchmarks (Builds/Benchmarks)
+    console builds share: reading their command-line options, and playing a
+    file through the application's whole playback path on a
+    HeadlessAudioDevice. The GUI application doesn't include this.
+*/
+namespace CommandLineHarness
+{
+    /** Returns the argument that follows the named option, or defaultValue if
+        the option isn't there. */
+    inline String getOptionValue (const StringArray& args, const String& name, const String& defaultValue)
+    {
+        const int index = args.indexOf (name);
+        return index >= 0 && index + 1 < args.size() ? args[index + 1].unquoted() : defaultValue;
+    }
+
+    /** Plays the file from the start until the output buffer is full. */
+    inline bool playThroughHeadlessDevice (const File& file, HeadlessAudioDevice& device, AudioSampleBuffer& output)
+    {
+        MainContentComponent content;
+
+        if (! content.startHeadlessPlayback (file))
+            return false;
+
+        device.open (BigInteger(), device.getActiveOutputChannels(),
+                     device.getCurrentSampleRate(), device.getCurrentBufferSizeSamples());
+
+        AudioSourcePlayer player;
+        player.setSource (&content);
+        device.start (&player);
+
+        device.render (output.getNumSamples() / device.getCurrentBufferSizeSamples(), &output);
+
+        device.stop();
+        player.setSource (nullptr);
+        return true;
+    }
+}
+
+#endif  // COMMANDLINEHARNESS_H_INCLUDED
@@ -0,0 +1,386 @@
+#ifndef DECODEDBLOCKCACHE_H_INCLUDED
+#define DECODEDBLOCKCACHE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Tracer.h"
+
+//==============================================================================
+/*
+    A cache of decoded audio, shared by everything that reads the same file.
+
+    Files are decoded in fixed-size blocks. Each block is kept as a
+    reference-counted buffer, so it stays valid for as long as a reader is
+    copying from it, even if the cache evicts it meanwhile. The cached blocks
+    are also linked into a list in the order they were last used, so when the
+    total goes over the memory budget, the least recently used blocks are
+    dropped from its head without searching.
+
+    createReaderFor() returns an ordinary AudioFormatReader that reads through
+    the cache. That reader can be handed to an AudioFormatReaderSource, an
+    AudioThumbnail or any analysis code, so each part of the file is only
+    decoded once however many of them are looking at it.
+
+    All methods can be called from any thread except the audio thread. A miss
+    decodes the block on the calling thread. The one exception is headless
+    playback (MainContentComponent::loadFileHeadless()). It plays without a
+    read-ahead thread, so that the output doesn't depend on timing, and its
+    CachedReader decodes and takes the lock on the HeadlessAudioDevice's
+    callback. That device has no deadline to miss, but the blocking count it
+    reports includes those reads.
+*/
+class DecodedBlockCache
+{
+public:
+    DecodedBlockCache (AudioFormatManager& formatManagerToUse,
+                       size_t memoryBudgetInBytes = 256 * 1024 * 1024)
+       : formatManager (formatManagerToUse),
+         memoryBudget (memoryBudgetInBytes)
+    {
+    }
+
+    //==============================================================================
+    /** Returns a reader for the file that goes through the cache, or nullptr if
+        the file can't be opened. The caller owns the reader. */
+    AudioFormatReader* createReaderFor (const File& file)
+    {
+        SourceFile::Ptr source (findOrOpenSource (file));
+
+        return source != nullptr ? new CachedReader (*this, source) : nullptr;
+    }
+
+    /** Returns a reader with its own decoder that doesn't go through the cache,
+        or nullptr if the file can't be opened. The caller owns the reader.
+
+        This is for bulk analysis that reads a whole file once. Each of these
+        readers decodes independently, so parallel jobs don't queue on the
+        file's shared decoder, and the blocks that playback and the thumbnail
+        are using aren't pushed out of the cache by a single pass.
+    */
+    AudioFormatReader* createUncachedReaderFor (const File& file)
+    {
+        return formatManager.createReaderFor (file);
+    }
+
+    void setMemoryBudget (size_t newBudgetInBytes)
+    {
+        const ScopedLock sl (lock);
+        memoryBudget = newBudgetInBytes;
+        evictBlocksOverBudget();
+    }
+
+    //==============================================================================
+    struct Statistics
+    {
+        int64 hits, misses;
+        int numBlocks;
+        size_t bytesUsed, memoryBudget;
+
+        double getHitRate() const noexcept
+        {
+            return hits + misses > 0 ? hits / (double) (hits + misses) : 0.0;
+        }
+    };
+
+    Statistics getStatistics() const
+    {
+        const ScopedLock sl (lock);
+        const Statistics stats = { hits.get(), misses.get(), blocks.size(), bytesUsed, memoryBudget };
+        return stats;
+    }
+
+    String getStatisticsDescription() const
+    {
+        const Statistics stats (getStatistics());
+
+        return "Decoded block cache: " + String (stats.hits) + " hits, " + String (stats.misses) + " misses ("
+                 + String (stats.getHitRate() * 100.0, 1) + "% hit rate), " + String (stats.numBlocks) + " blocks, "
+                 + String (stats.bytesUsed / (1024.0 * 1024.0), 1) + " of "
+                 + String (stats.memoryBudget / (1024.0 * 1024.0), 1) + " MB";
+    }
+
+    enum { samplesPerBlock = 32768 };
+
+private:
+    //==============================================================================
+    struct Block  : public ReferenceCountedObject
+    {
+        typedef ReferenceCountedObjectPtr<Block> Ptr;
+
+        AudioSampleBuffer samples;
+
+        // the least recently used list, only touched under the cache's lock
+        int64 key = 0;
+        Block* previous = nullptr;
+        Block* next = nullptr;
+
+        size_t getSizeInBytes() const noexcept
+        {
+            return (size_t) samples.getNumChannels() * (size_t) samples.getNumSamples() * sizeof (float);
+        }
+    };
+
+    // One decoder per file, shared by all of that file's CachedReaders.
+    struct SourceFile  : public ReferenceCountedObject
+    {
+        typedef ReferenceCountedObjectPtr<SourceFile> Ptr;
+
+        SourceFile (const File& f, AudioFormatReader* r, int id)
+            : file (f), reader (r), fileId (id)
+        {
+        }
+
+        Block::Ptr decodeBlock (int64 blockIndex)
+        {
+            TRACE_SCOPE ("Decode block");
+
+            Block::Ptr block (new Block());
+
+            const int64 start = blockIndex * samplesPerBlock;
+            const int numSamples = (int) jlimit ((int64) 0, (int64) samplesPerBlock, reader->lengthInSamples - start);
+
+            block->samples.setSize ((int) reader->numChannels, numSamples);
+
+            const ScopedLock sl (readerLock);
+            reader->read (&block->samples, 0, numSamples, start, true, true);
+
+            return block;
+        }
+
+        const File file;
+        CriticalSection readerLock;
+        const ScopedPointer<AudioFormatReader> reader;
+        const int fileId;
+    };
+
+    //==============================================================================
+    class CachedReader  : public AudioFormatReader
+    {
+    public:
+        CachedReader (DecodedBlockCache& c, SourceFile* s)
+            : AudioFormatReader (nullptr, s->reader->getFormatName()),
+              cache (c), source (s)
+        {
+            const AudioFormatReader& original = *s->reader;
+
+            sampleRate = original.sampleRate;
+            lengthInSamples = original.lengthInSamples;
+            numChannels = original.numChannels;
+            metadataValues = original.metadataValues;
+            bitsPerSample = 32;
+            usesFloatingPointData = true;
+        }
+
+        bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                          int64 startSampleInFile, int numSamples) override
+        {
+            while (numSamples > 0)
+            {
+                const int64 blockIndex = startSampleInFile / samplesPerBlock;
+                const int offsetInBlock = (int) (startSampleInFile % samplesPerBlock);
+
+                const Block::Ptr block (cache.getBlock (*source, blockIndex));
+                const int numAvailable = jmax (0, block->samples.getNumSamples() - offsetInBlock);
+                const int numToCopy = jmin (numSamples, samplesPerBlock - offsetInBlock);
+
+                for (int ch = 0; ch < numDestChannels; ++ch)
+                {
+                    float* dest = reinterpret_cast<float*> (destSamples[ch]);
+
+                    if (dest == nullptr)
+                        continue;
+
+                    dest += startOffsetInDestBuffer;
+
+                    // past the end of the file, or a channel the file doesn't have
+                    if (ch >= block->samples.getNumChannels() || numAvailable == 0)
+                    {
+                        FloatVectorOperations::clear (dest, numToCopy);
+                        continue;
+                    }
+
+                    const int n = jmin (numToCopy, numAvailable);
+                    FloatVectorOperations::copy (dest, block->samples.getReadPointer (ch, offsetInBlock), n);
+
+                    if (n < numToCopy)
+                        FloatVectorOperations::clear (dest + n, numToCopy - n);
+                }
+
+                startOffsetInDestBuffer += numToCopy;
+                startSampleInFile += numToCopy;
+                numSamples -= numToCopy;
+            }
+
+            return true;
+        }
+
+    private:
+        DecodedBlockCache& cache;
+        SourceFile::Ptr source;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CachedReader)
+    };
+
+    //==============================================================================
+    SourceFile::Ptr findOrOpenSource (const File& file)
+    {
+        {
+            const ScopedLock sl (lock);
+
+            releaseUnusedSources();
+
+            if (SourceFile* existing = findSource (file))
+                return existing;
+        }
+
+        // Opening can be slow, so it's done without holding the lock, which
+        // would hold up every other reader in the meantime.
+        ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+        if (reader == nullptr)
+            return nullptr;
+
+        const ScopedLock sl (lock);
+
+        // another thread may have opened it first
+        if (SourceFile* existing = findSource (file))
+            return existing;
+
+        return sources.add (new SourceFile (file, reader.release(), nextFileId++));
+    }
+
+    SourceFile* findSource (const File& file) const
+    {
+        for (int i = 0; i < sources.size(); ++i)
+            if (sources.getObjectPointerUnchecked (i)->file == file)
+                return sources.getObjectPointerUnchecked (i);
+
+        return nullptr;
+    }
+
+    // Drops files that no reader refers to any more, along with their blocks.
+    void releaseUnusedSources()
+    {
+        for (int i = sources.size(); --i >= 0;)
+        {
+            SourceFile* source = sources.getObjectPointerUnchecked (i);
+
+            if (source->getReferenceCount() == 1)
+            {
+                removeBlocksForFile (source->fileId);
+                sources.remove (i);
+            }
+        }
+    }
+
+    Block::Ptr getBlock (SourceFile& source, int64 blockIndex)
+    {
+        const int64 key = ((int64) source.fileId << 40) | blockIndex;
+
+        {
+            const ScopedLock sl (lock);
+
+            if (Block* existing = blocks[key])
+            {
+                unlink (*existing);
+                append (*existing);
+                ++hits;
+                return existing;
+            }
+        }
+
+        ++misses;
+
+        // Decoded outside the cache lock, so that a miss on one file doesn't
+        // hold up hits on another.
+        Block::Ptr block (source.decodeBlock (blockIndex));
+
+        const ScopedLock sl (lock);
+
+        // someone else may have decoded the same block in the meantime
+        if (Block* existing = blocks[key])
+            return existing;
+
+        block->key = key;
+        append (*block);
+        blocks.set (key, block);
+        bytesUsed += block->getSizeInBytes();
+        evictBlocksOverBudget();
+
+        return block;
+    }
+
+    void evictBlocksOverBudget()
+    {
+        while (bytesUsed > memoryBudget && blocks.size() > 1)
+            removeBlock (*leastRecentlyUsed);
+    }
+
+    // Called under the lock.
+    void removeBlock (Block& block)
+    {
+        const Block::Ptr keepUntilUnlinked (&block);
+
+        unlink (block);
+        bytesUsed -= block.getSizeInBytes();
+        blocks.remove (block.key);
+    }
+
+    // The list runs from the least recently used block to the most recent.
+    void append (Block& block) noexcept
+    {
+        block.previous = mostRecentlyUsed;
+        block.next = nullptr;
+
+        if (mostRecentlyUsed != nullptr)
+            mostRecentlyUsed->next = &block;
+        else
+            leastRecentlyUsed = &block;
+
+        mostRecentlyUsed = &block;
+    }
+
+    void unlink (Block& block) noexcept
+    {
+        if (block.previous != nullptr)
+            block.previous->next = block.next;
+        else
+            leastRecentlyUsed = block.next;
+
+        if (block.next != nullptr)
+            block.next->previous = block.previous;
+        else
+            mostRecentlyUsed = block.previous;
+
+        block.previous = block.next = nullptr;
+    }
+
+    void removeBlocksForFile (int fileId)
+    {
+        for (Block* block = leastRecentlyUsed; block != nullptr;)
+        {
+            Block* const next = block->next;
+
+            if ((block->key >> 40) == fileId)
+                removeBlock (*block);
+
+            block = next;
+        }
+    }
+
+    //==============================================================================
+    AudioFormatManager& formatManager;
+
+    CriticalSection lock;
+    ReferenceCountedArray<SourceFile> sources;
+    HashMap<int64, Block::Ptr> blocks;
+    Block* leastRecentlyUsed = nullptr;
+    Block* mostRecentlyUsed = nullptr;
+    size_t memoryBudget, bytesUsed = 0;
+    int nextFileId = 0;
+
+    Atomic<int64> hits, misses;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecodedBlockCache)
+};
+
+#endif  // DECODEDBLOCKCACHE_H_INCLUDED
@@ -0,0 +1,162 @@
+#ifndef FILEOPENER_H_INCLUDED
+#define FILEOPENER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DecodedBlockCache.h"
+#include "Tracer.h"
+
+//==============================================================================
+/*
+    Opens audio files on a background thread, so that the message thread never
+    waits while a format parses its header or scans the file. That can take a
+    long time for big files or files on a network share.
+
+    open() hands a file to the thread and returns at once. The thread creates
+    a reader through the DecodedBlockCache, so the file's decoder is opened and
+    kept there for everything else that reads it. It also decodes the first
+    block, so playback and the thumbnail can start from memory. A change
+    message is sent when the file is ready; the message thread then collects
+    the reader with takeOpenedFile().
+
+    Calling open() again, or cancel(), replaces any file that's still being
+    opened. A header that's already being parsed can't be interrupted, but its
+    result is thrown away, so only the most recent request is ever delivered.
+*/
+class FileOpener : public ChangeBroadcaster,
+                   private Thread
+{
+public:
+    FileOpener (DecodedBlockCache& cacheToUse)
+       : Thread ("File opener"),
+         blockCache (cacheToUse)
+    {
+    }
+
+    ~FileOpener()
+    {
+        stopThread (5000);
+    }
+
+    //==============================================================================
+    /** Starts opening a file, cancelling whatever was being opened before. */
+    void open (const File& file)
+    {
+        {
+            const ScopedLock sl (lock);
+            requestedFile = file;
+            ++requestNumber;
+            openedReader = nullptr;
+            failed = false;
+        }
+
+        if (! isThreadRunning())
+            startThread (4);
+
+        notify();
+    }
+
+    void cancel()
+    {
+        open (File());
+    }
+
+    /** Returns the file that is being opened, or File() if there isn't one.
+        That includes a file that has been opened but not yet collected. */
+    File getFileBeingOpened() const
+    {
+        const ScopedLock sl (lock);
+        return requestedFile;
+    }
+
+    bool isOpening() const                          { return getFileBeingOpened() != File(); }
+
+    /** Collects the result of the last open(), once its change message has
+        arrived. The reader is set to nullptr if the file couldn't be opened.
+        Returns false if the file is still being opened, or the result has
+        already been collected. */
+    bool takeOpenedFile (File& file, ScopedPointer<AudioFormatReader>& reader)
+    {
+        const ScopedLock sl (lock);
+
+        if (requestedFile == File() || (openedReader == nullptr && ! failed))
+            return false;
+
+        file = requestedFile;
+        reader = openedReader.release();
+        requestedFile = File();
+        failed = false;
+        return true;
+    }
+
+private:
+    //==============================================================================
+    void run() override
+    {
+        int lastHandled = 0;
+
+        while (! threadShouldExit())
+        {
+            File file;
+            int request;
+
+            {
+                const ScopedLock sl (lock);
+                file = requestedFile;
+                request = requestNumber;
+            }
+
+            if (request == lastHandled || file == File())
+            {
+                lastHandled = request;
+                wait (-1);
+                continue;
+            }
+
+            lastHandled = request;
+
+            ScopedPointer<AudioFormatReader> reader (openFile (file));
+
+            {
+                const ScopedLock sl (lock);
+
+                // superseded while it was opening
+                if (request != requestNumber)
+                    continue;
+
+                openedReader = reader.release();
+                failed = (openedReader == nullptr);
+            }
+
+            sendChangeMessage();
+        }
+    }
+
+    AudioFormatReader* openFile (const File& file)
+    {
+        TRACE_SCOPE ("Open file");
+
+        ScopedPointer<AudioFormatReader> reader (blockCache.createReaderFor (file));
+
+        if (reader != nullptr && reader->lengthInSamples > 0 && ! threadShouldExit())
+        {
+            AudioSampleBuffer firstBlock ((int) reader->numChannels, (int) jmin (reader->lengthInSamples,
+                                                                               (int64) DecodedBlockCache::samplesPerBlock));
+            reader->read (&firstBlock, 0, firstBlock.getNumSamples(), 0, true, true);
+        }
+
+        return reader.release();
+    }
+
+    //==============================================================================
+    DecodedBlockCache& blockCache;
+
+    CriticalSection lock;
+    File requestedFile;
+    int requestNumber = 0;
+    ScopedPointer<AudioFormatReader> openedReader;
+    bool failed = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FileOpener)
+};
+
+#endif  // FILEOPENER_H_INCLUDED
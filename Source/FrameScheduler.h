@@ -0,0 +1,203 @@
+#ifndef FRAMESCHEDULER_H_INCLUDED
+#define FRAMESCHEDULER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Tracer.h"
+
+//==============================================================================
+/*
+    One timer that drives everything animated in the window, instead of each
+    component running its own.
+
+    Each frame, every Client is advanced in turn. Clients don't call repaint()
+    themselves but invalidate() the areas they changed. The scheduler merges
+    those into one area per component and repaints them together at the end
+    of the frame.
+
+    The scheduler only ticks while something needs it:
+    - While any client says it's animating, it ticks at the target rate.
+    - Once none has been animating for a short while, it stops altogether.
+      Anything that starts animation again (pressing play, loading a file,
+      recording) calls wake().
+    - While the window isn't showing, for example when it's minimised,
+      nothing is painted. The ticks slow to a rate that just keeps the
+      clients' audio FIFOs drained.
+
+    A frame that arrives more than half a period late counts as dropped, for
+    however many periods were missed.
+*/
+class FrameScheduler : private Timer
+{
+public:
+    class Client
+    {
+    public:
+        virtual ~Client() {}
+
+        /** Returns true while the client has something that moves. */
+        virtual bool isAnimating() = 0;
+
+        /** Called once per frame, on the message thread. */
+        virtual void advanceFrame (FrameScheduler& scheduler) = 0;
+    };
+
+    FrameScheduler (Component& windowContent, int targetFramesPerSecond)
+       : content (windowContent),
+         targetRate (targetFramesPerSecond)
+    {
+    }
+
+    //==============================================================================
+    void addClient (Client* client)                 { clients.addIfNotAlreadyThere (client); }
+    void removeClient (Client* client)              { clients.removeFirstMatchingValue (client); }
+
+    /** Starts ticking at the target rate, if it isn't already. */
+    void wake()
+    {
+        framesUntilIdle = lingerFrames;
+
+        if (currentRate != targetRate && content.isShowing())
+            setRate (targetRate);
+        else if (currentRate == 0)
+            setRate (hiddenRate);
+    }
+
+    /** Asks for part of a component to be repainted at the end of this frame. */
+    void invalidate (Component& component, const Rectangle<int>& area)
+    {
+        if (area.isEmpty())
+            return;
+
+        for (int i = 0; i < pending.size(); ++i)
+        {
+            PendingRepaint& p = pending.getReference (i);
+
+            if (p.component == &component)
+            {
+                p.area = p.area.getUnion (area);
+                return;
+            }
+        }
+
+        const PendingRepaint p = { &component, area };
+        pending.add (p);
+    }
+
+    void invalidate (Component& component)          { invalidate (component, component.getLocalBounds()); }
+
+    //==============================================================================
+    /** Describes the frame rate and dropped frames since the last reset. */
+    String getStatistics() const
+    {
+        String text ("frames: ");
+
+        if (currentRate == 0)
+            text << "idle";
+        else if (currentRate != targetRate)
+            text << "window hidden";
+        else
+            text << String (1000.0 / jmax (1.0, smoothedIntervalMs), 1) << " fps";
+
+        text << ", " << numDropped << " dropped of " << numFrames;
+        return text;
+    }
+
+    void resetStatistics()
+    {
+        numFrames = 0;
+        numDropped = 0;
+    }
+
+private:
+    //==============================================================================
+    enum
+    {
+        hiddenRate = 2,
+        lingerFrames = 15    // keeps going briefly so that the last positions get drawn
+    };
+
+    struct PendingRepaint
+    {
+        Component::SafePointer<Component> component;
+        Rectangle<int> area;
+    };
+
+    void setRate (int framesPerSecond)
+    {
+        currentRate = framesPerSecond;
+        lastFrameMs = 0.0;
+
+        if (framesPerSecond > 0)
+            startTimerHz (framesPerSecond);
+        else
+            stopTimer();
+    }
+
+    void timerCallback() override
+    {
+        TRACE_SCOPE ("Frame");
+
+        const bool showing = content.isShowing();
+        countFrame();
+
+        bool anyAnimating = false;
+
+        for (int i = 0; i < clients.size(); ++i)
+        {
+            Client* client = clients.getUnchecked (i);
+            anyAnimating = client->isAnimating() || anyAnimating;
+            client->advanceFrame (*this);
+        }
+
+        if (showing)
+            for (int i = 0; i < pending.size(); ++i)
+                if (Component* c = pending.getReference (i).component)
+                    c->repaint (pending.getReference (i).area);
+
+        pending.clearQuick();
+
+        if (anyAnimating)
+            framesUntilIdle = lingerFrames;
+        else
+            --framesUntilIdle;
+
+        if (framesUntilIdle <= 0)
+            setRate (0);
+        else if (showing != (currentRate == targetRate))
+            setRate (showing ? targetRate : hiddenRate);
+    }
+
+    void countFrame()
+    {
+        const double now = Time::getMillisecondCounterHiRes();
+
+        if (lastFrameMs > 0.0 && currentRate == targetRate)
+        {
+            const double interval = now - lastFrameMs;
+            const double period = 1000.0 / targetRate;
+
+            smoothedIntervalMs += (interval - smoothedIntervalMs) * 0.1;
+            ++numFrames;
+
+            if (interval > period * 1.5)
+                numDropped += roundToInt (interval / period) - 1;
+        }
+
+        lastFrameMs = now;
+    }
+
+    //==============================================================================
+    Component& content;
+    const int targetRate;
+    int currentRate = 0, framesUntilIdle = 0;
+
+    Array<Client*> clients;
+    Array<PendingRepaint> pending;
+
+    double lastFrameMs = 0.0, smoothedIntervalMs = 0.0;
+    int64 numFrames = 0, numDropped = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FrameScheduler)
+};
+
+#endif  // FRAMESCHEDULER_H_INCLUDED
@@ -0,0 +1,230 @@
+#ifndef GONIOMETER_H_INCLUDED
+#define GONIOMETER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameScheduler.h"
+#include "Tracer.h"
+
+//==============================================================================
+/*
+    A stereo vectorscope (goniometer) with a correlation meter underneath.
+
+    pushSamples() is called on the audio thread with the samples about to leave
+    the app. It copies them into a lock-free ring and never blocks. Anything
+    that doesn't fit is dropped. The rest happens once per frame, driven by a
+    FrameScheduler:
+
+    - the ring is drained and decimated to a fixed number of points per frame;
+    - the points are plotted, rotated so that mono is vertical, into a
+      single-channel Image whose previous contents are first faded out;
+    - the Image is drawn filled with the trace colour.
+
+    The Image is only reallocated when the component is resized. Once the
+    signal has been silent long enough for the trace to fade out completely,
+    the scope stops asking for frames.
+*/
+class Goniometer : public Component,
+                   public FrameScheduler::Client
+{
+public:
+    Goniometer()
+       : fifo (ringSize)
+    {
+        ring.setSize (2, ringSize);
+    }
+
+    //==============================================================================
+    /** Called on the audio thread. Mono buffers are shown as a vertical line. */
+    void pushSamples (const AudioSampleBuffer& buffer, int startSample, int numSamples) noexcept
+    {
+        const int left = 0;
+        const int right = buffer.getNumChannels() > 1 ? 1 : 0;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+        if (size1 > 0)
+        {
+            ring.copyFrom (0, start1, buffer, left,  startSample, size1);
+            ring.copyFrom (1, start1, buffer, right, startSample, size1);
+        }
+
+        if (size2 > 0)
+        {
+            ring.copyFrom (0, start2, buffer, left,  startSample + size1, size2);
+            ring.copyFrom (1, start2, buffer, right, startSample + size1, size2);
+        }
+
+        fifo.finishedWrite (size1 + size2);
+    }
+
+    /** Returns the smoothed left/right correlation, from -1 (out of phase)
+        through 0 (unrelated) to +1 (mono). */
+    float getCorrelation() const noexcept       { return correlation; }
+
+    bool isAnimating() override                 { return silentFrames < framesToFadeOut; }
+
+    //==============================================================================
+    void paint (Graphics& g) override
+    {
+        TRACE_SCOPE ("Goniometer paint");
+
+        const Rectangle<int> scopeArea (getScopeArea());
+
+        g.setColour (Colours::black);
+        g.fillRect (scopeArea);
+
+        // L and R axes, with mono pointing straight up
+        const Rectangle<float> area (scopeArea.toFloat());
+        g.setColour (Colours::darkgrey);
+        g.drawLine (area.getX(), area.getY(), area.getRight(), area.getBottom(), 1.0f);
+        g.drawLine (area.getRight(), area.getY(), area.getX(), area.getBottom(), 1.0f);
+        g.drawVerticalLine (scopeArea.getCentreX(), area.getY(), area.getBottom());
+
+        g.setColour (Colours::limegreen);
+        g.drawImageAt (trace, scopeArea.getX(), scopeArea.getY(), true);
+
+        const Rectangle<int> meterArea (getMeterArea());
+        g.setColour (Colours::black);
+        g.fillRect (meterArea);
+
+        const int centre = meterArea.getCentreX();
+        const int x = centre + roundToInt (correlation * meterArea.getWidth() * 0.5f);
+
+        g.setColour (correlation < 0.0f ? Colours::red : Colours::limegreen);
+        g.fillRect (Rectangle<int>::leftTopRightBottom (jmin (centre, x), meterArea.getY(),
+                                                        jmax (centre, x), meterArea.getBottom()));
+
+        g.setColour (Colours::white);
+        g.drawVerticalLine (centre, (float) meterArea.getY(), (float) meterArea.getBottom());
+    }
+
+    void resized() override
+    {
+        const Rectangle<int> scopeArea (getScopeArea());
+
+        if (scopeArea.getWidth() > 0 && scopeArea.getHeight() > 0)
+            trace = Image (Image::SingleChannel, scopeArea.getWidth(), scopeArea.getHeight(), true);
+        else
+            trace = Image();
+    }
+
+private:
+    //==============================================================================
+    enum
+    {
+        ringSize = 16384,
+        maxPointsPerFrame = 1024,
+        meterHeight = 10,
+        framesToFadeOut = 30    // by then the fade has taken every pixel to zero
+    };
+
+    Rectangle<int> getScopeArea() const
+    {
+        Rectangle<int> area (getLocalBounds());
+        area.removeFromBottom (meterHeight + 2);
+
+        const int size = jmin (area.getWidth(), area.getHeight());
+        return area.withSizeKeepingCentre (size, size);
+    }
+
+    Rectangle<int> getMeterArea() const
+    {
+        return getLocalBounds().removeFromBottom (meterHeight);
+    }
+
+    void advanceFrame (FrameScheduler& scheduler) override
+    {
+        const int numReady = fifo.getNumReady();
+
+        if (trace.isNull())
+        {
+            fifo.finishedRead (numReady);
+            silentFrames = framesToFadeOut;
+            return;
+        }
+
+        const Image::BitmapData bitmap (trace, Image::BitmapData::readWrite);
+        fadeTrace (bitmap);
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+        const int step = jmax (1, numReady / maxPointsPerFrame);
+        double sumLR = 0.0, sumLL = 0.0, sumRR = 0.0;
+
+        plotSection (bitmap, start1, size1, step, sumLR, sumLL, sumRR);
+        plotSection (bitmap, start2, size2, step, sumLR, sumLL, sumRR);
+
+        fifo.finishedRead (size1 + size2);
+
+        if (sumLL > 0.0 && sumRR > 0.0)
+        {
+            const float frameCorrelation = (float) (sumLR / std::sqrt (sumLL * sumRR));
+            correlation += (frameCorrelation - correlation) * 0.2f;
+        }
+
+        if (sumLL + sumRR > 1.0e-8)
+            silentFrames = 0;
+        else if (silentFrames < framesToFadeOut)
+            ++silentFrames;
+
+        scheduler.invalidate (*this);
+    }
+
+    static void fadeTrace (const Image::BitmapData& bitmap) noexcept
+    {
+        for (int y = 0; y < bitmap.height; ++y)
+        {
+            uint8* pixel = bitmap.getLinePointer (y);
+
+            for (int x = 0; x < bitmap.width; ++x, pixel += bitmap.pixelStride)
+                *pixel = (uint8) ((*pixel * 200) >> 8);
+        }
+    }
+
+    // Plots every step'th sample, but measures the correlation over all of them.
+    void plotSection (const Image::BitmapData& bitmap, int start, int num, int step,
+                      double& sumLR, double& sumLL, double& sumRR) const noexcept
+    {
+        const float* left  = ring.getReadPointer (0, start);
+        const float* right = ring.getReadPointer (1, start);
+
+        const float halfWidth  = bitmap.width  * 0.5f;
+        const float halfHeight = bitmap.height * 0.5f;
+
+        for (int i = 0; i < num; ++i)
+        {
+            const float l = left[i], r = right[i];
+
+            sumLR += l * r;
+            sumLL += l * l;
+            sumRR += r * r;
+
+            if (i % step != 0)
+                continue;
+
+            // rotate by 45 degrees: side across, mid upwards
+            const int x = (int) (halfWidth  + (r - l) * 0.7071f * halfWidth);
+            const int y = (int) (halfHeight - (l + r) * 0.7071f * halfHeight);
+
+            if (isPositiveAndBelow (x, bitmap.width) && isPositiveAndBelow (y, bitmap.height))
+            {
+                uint8* pixel = bitmap.getPixelPointer (x, y);
+                *pixel = (uint8) jmin (255, *pixel + 96);
+            }
+        }
+    }
+
+    //==============================================================================
+    AbstractFifo fifo;
+    AudioSampleBuffer ring;
+
+    Image trace;
+    float correlation = 0.0f;
+    int silentFrames = framesToFadeOut;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Goniometer)
+};
+
+#endif  // GONIOMETER_H_INCLUDED
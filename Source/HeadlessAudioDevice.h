@@ -0,0 +1,295 @@
+#ifndef HEADLESSAUDIODEVICE_H_INCLUDED
+#define HEADLESSAUDIODEVICE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#if JUCE_LINUX
+ #include <sys/resource.h>
+#endif
+
+//==============================================================================
+/*
+    An AudioIODevice with no hardware behind it. Instead of a driver thread
+    calling back at the sound card's pace, render() calls the callback on the
+    calling thread as fast as it can, so the whole playback path can be run
+    faster than real time on a machine with no audio hardware.
+
+    Every callback is timed. Anything that happens inside one that a real-time
+    callback shouldn't do is counted:
+
+    - Heap allocations. These are counted by AllocationCounter.cpp, which
+      replaces malloc() and is only compiled into the tests build (Builds/Tests),
+      on Linux. Anywhere else they aren't measured.
+    - Times the thread gave up the CPU, such as waiting on a contended lock or
+      on disk I/O. These are counted from the thread's voluntary context
+      switches, which are only available on Linux. An uncontended lock doesn't
+      block, so it isn't counted.
+
+    getReport() returns the results as one line of key=value pairs.
+*/
+class HeadlessAudioDevice : public AudioIODevice
+{
+public:
+    HeadlessAudioDevice (double rate, int blockSize, int numOutputs = 2, int numInputs = 0)
+       : AudioIODevice ("Headless", "Headless"),
+         sampleRate (rate),
+         bufferSize (blockSize),
+         outputs (jmax (1, numOutputs), blockSize),
+         inputs (jmax (1, numInputs), blockSize)
+    {
+        outputChannels.setRange (0, numOutputs, true);
+        inputChannels.setRange (0, numInputs, true);
+    }
+
+    ~HeadlessAudioDevice()
+    {
+        close();
+    }
+
+    //==============================================================================
+    StringArray getOutputChannelNames() override        { return getChannelNames ("Output", outputChannels); }
+    StringArray getInputChannelNames() override         { return getChannelNames ("Input", inputChannels); }
+    Array<double> getAvailableSampleRates() override    { Array<double> rates; rates.add (sampleRate); return rates; }
+    Array<int> getAvailableBufferSizes() override       { Array<int> sizes; sizes.add (bufferSize); return sizes; }
+    int getDefaultBufferSize() override                 { return bufferSize; }
+
+    String open (const BigInteger&, const BigInteger&, double, int) override
+    {
+        opened = true;
+        return String();
+    }
+
+    void close() override
+    {
+        stop();
+        opened = false;
+    }
+
+    bool isOpen() override                              { return opened; }
+
+    void start (AudioIODeviceCallback* newCallback) override
+    {
+        if (newCallback != nullptr && callback == nullptr)
+        {
+            newCallback->audioDeviceAboutToStart (this);
+            callback = newCallback;
+        }
+    }
+
+    void stop() override
+    {
+        if (AudioIODeviceCallback* oldCallback = callback)
+        {
+            callback = nullptr;
+            oldCallback->audioDeviceStopped();
+        }
+    }
+
+    bool isPlaying() override                           { return callback != nullptr; }
+    String getLastError() override                      { return String(); }
+    int getCurrentBufferSizeSamples() override          { return bufferSize; }
+    double getCurrentSampleRate() override              { return sampleRate; }
+    int getCurrentBitDepth() override                   { return 32; }
+    BigInteger getActiveOutputChannels() const override { return outputChannels; }
+    BigInteger getActiveInputChannels() const override  { return inputChannels; }
+    int getOutputLatencyInSamples() override            { return 0; }
+    int getInputLatencyInSamples() override             { return 0; }
+
+    //==============================================================================
+    /** Sets a source that fills the inputs before each callback, or nullptr
+        for silent inputs. It's prepared here, and it isn't owned. */
+    void setInputSource (AudioSource* source)
+    {
+        if (source != nullptr)
+            source->prepareToPlay (bufferSize, sampleRate);
+
+        inputSource = source;
+    }
+
+    /** Calls the callback for a number of blocks, with the inputs filled from
+        the input source, if there is one. If a destination is given, each
+        block's output is copied into it in turn, starting at the given sample. */
+    void render (int numBlocks, AudioSampleBuffer* destination = nullptr, int destinationStart = 0)
+    {
+        if (callback == nullptr)
+            return;
+
+        blockTicks.ensureStorageAllocated (blockTicks.size() + numBlocks);
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            inputs.clear();
+            outputs.clear();
+
+            if (inputSource != nullptr)
+                inputSource->getNextAudioBlock (AudioSourceChannelInfo (&inputs, 0, bufferSize));
+
+            const int64 switchesBefore = getVoluntaryContextSwitches();
+            const int64 allocationsBefore = allocationsInCallback();
+            const int64 start = Time::getHighResolutionTicks();
+
+            isInsideCallback() = true;
+            callback->audioDeviceIOCallback (inputs.getArrayOfReadPointers(), inputChannels.countNumberOfSetBits(),
+                                             outputs.getArrayOfWritePointers(), outputChannels.countNumberOfSetBits(),
+                                             bufferSize);
+            isInsideCallback() = false;
+
+            blockTicks.add (Time::getHighResolutionTicks() - start);
+
+            const int64 allocations = allocationsInCallback() - allocationsBefore;
+            const int64 switches = getVoluntaryContextSwitches() - switchesBefore;
+
+            if (allocations > 0)    ++numBlocksAllocating;
+            if (switches > 0)       ++numBlocksBlocking;
+
+            if (destination != nullptr)
+            {
+                const int pos = destinationStart + block * bufferSize;
+                const int num = jmin (bufferSize, destination->getNumSamples() - pos);
+
+                for (int ch = 0; ch < jmin (destination->getNumChannels(), outputs.getNumChannels()); ++ch)
+                    if (num > 0)
+                        destination->copyFrom (ch, pos, outputs, ch, 0, num);
+            }
+        }
+    }
+
+    /** Returns the timings and counts for every block rendered so far. */
+    String getReport() const
+    {
+        Array<int64> sorted (blockTicks);
+        sorted.sort();
+
+        const int numBlocks = sorted.size();
+        int64 total = 0;
+
+        for (int i = 0; i < numBlocks; ++i)
+            total += sorted.getUnchecked (i);
+
+        const double seconds = Time::highResolutionTicksToSeconds (total);
+        const double audioSeconds = numBlocks * bufferSize / sampleRate;
+
+        String report;
+        report << "callback blocks=" << numBlocks
+               << " block_size=" << bufferSize
+               << " sample_rate=" << sampleRate
+               << " mean_us=" << String (numBlocks > 0 ? seconds * 1.0e6 / numBlocks : 0.0, 2)
+               << " p99_us=" << String (ticksToMicroseconds (sorted[(numBlocks * 99) / 100]), 2)
+               << " max_us=" << String (ticksToMicroseconds (sorted.isEmpty() ? 0 : sorted.getLast()), 2)
+               << " realtime_factor=" << String (seconds > 0.0 ? audioSeconds / seconds : 0.0, 1)
+               << " allocations=" << allocationsInCallback()
+               << " blocks_allocating=" << numBlocksAllocating
+               << " blocks_blocking=" << numBlocksBlocking;
+
+        if (! isCountingAllocations())
+            report << " (allocations not measured)";
+
+        #if ! JUCE_LINUX
+        report << " (blocking not measured)";
+        #endif
+
+        return report;
+    }
+
+    int getNumBlocksAllocating() const noexcept         { return numBlocksAllocating; }
+    int getNumBlocksBlocking() const noexcept           { return numBlocksBlocking; }
+
+    /** Returns the longest a block has taken, in microseconds. */
+    double getMaxBlockMicroseconds() const
+    {
+        int64 longest = 0;
+
+        for (int i = 0; i < blockTicks.size(); ++i)
+            longest = jmax (longest, blockTicks.getUnchecked (i));
+
+        return ticksToMicroseconds (longest);
+    }
+
+    /** Forgets the timings and counts so far. The timings' storage is kept, so a
+        long run that renders and clears in turn stops growing after the first
+        batch. */
+    void clearStatistics() noexcept
+    {
+        blockTicks.clearQuick();
+        numBlocksAllocating = numBlocksBlocking = 0;
+    }
+
+    //==============================================================================
+    /** Returns true if allocations are being counted, which is only the case
+        in the tests build on Linux. */
+    static bool isCountingAllocations() noexcept
+    {
+       #if AUDIOTHUMBNAIL_TESTS && JUCE_LINUX && defined (__GLIBC__)
+        return true;
+       #else
+        return false;
+       #endif
+    }
+
+    /** Called from AllocationCounter.cpp's replacement malloc(), calloc() and
+        realloc(). Counts the allocation if this thread is inside a render()
+        callback. It mustn't allocate itself. */
+    static void noteAllocation() noexcept
+    {
+        if (isInsideCallback())
+            ++allocationsInCallback();
+    }
+
+private:
+    //==============================================================================
+    static bool& isInsideCallback() noexcept
+    {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    static int64& allocationsInCallback() noexcept
+    {
+        static thread_local int64 count = 0;
+        return count;
+    }
+
+    static int64 getVoluntaryContextSwitches() noexcept
+    {
+       #if JUCE_LINUX
+        struct rusage usage;
+
+        if (getrusage (RUSAGE_THREAD, &usage) == 0)
+            return (int64) usage.ru_nvcsw;
+       #endif
+
+        return 0;
+    }
+
+    static double ticksToMicroseconds (int64 ticks) noexcept
+    {
+        return Time::highResolutionTicksToSeconds (ticks) * 1.0e6;
+    }
+
+    static StringArray getChannelNames (const String& prefix, const BigInteger& channels)
+    {
+        StringArray names;
+
+        for (int i = 0; i < channels.countNumberOfSetBits(); ++i)
+            names.add (prefix + " " + String (i + 1));
+
+        return names;
+    }
+
+    //==============================================================================
+    const double sampleRate;
+    const int bufferSize;
+    BigInteger outputChannels, inputChannels;
+    AudioSampleBuffer outputs, inputs;
+
+    bool opened = false;
+    AudioIODeviceCallback* callback = nullptr;
+    AudioSource* inputSource = nullptr;
+
+    Array<int64> blockTicks;
+    int numBlocksAllocating = 0, numBlocksBlocking = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HeadlessAudioDevice)
+};
+
+#endif  // HEADLESSAUDIODEVICE_H_INCLUDED
@@ -0,0 +1,243 @@
+#ifndef HOTSWAPAUDIOSOURCE_H_INCLUDED
+#define HOTSWAPAUDIOSOURCE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    A slot for the source that the transport plays from, where a new source can
+    be swapped in while it's playing, without stopping or taking a lock.
+
+    swapTo() prepares the new source on the message thread and publishes it
+    with an atomic exchange. The thread that pulls audio from the slot picks it
+    up at the start of its next block. The new source carries on from the same
+    position, and the old one is crossfaded out over the crossfade length. The
+    old source is then handed back through a second atomic pointer, and
+    releaseRetiredSources() deletes it on the message thread. The audio side
+    never allocates, deletes or waits.
+
+    Another swapTo() before the last one has been picked up replaces it. A
+    source that's still fading out holds up the next swap until the fade ends,
+    so at most two sources are ever read at once.
+
+    setSource() replaces the source outright, and must only be called while
+    nothing is pulling audio from the slot.
+*/
+class HotSwapAudioSource : public PositionableAudioSource
+{
+public:
+    HotSwapAudioSource()
+    {
+        crossfadeMs.set (defaultCrossfadeMs);
+    }
+
+    ~HotSwapAudioSource()
+    {
+        delete current.get();
+        delete fadingOut;
+        delete incoming.exchange (nullptr);
+        delete retired.exchange (nullptr);
+    }
+
+    //==============================================================================
+    /** Replaces the source straight away, taking ownership of it. Only call
+        this while the slot isn't being played. */
+    void setSource (PositionableAudioSource* newSource)
+    {
+        releaseRetiredSources();
+        delete incoming.exchange (nullptr);
+        deleteAndZero (fadingOut);
+        delete current.exchange (newSource);
+
+        if (newSource != nullptr)
+        {
+            newSource->setLooping (looping);
+
+            if (isPrepared)
+                newSource->prepareToPlay (blockSize, sampleRate);
+        }
+    }
+
+    /** Crossfades to a new source while the slot is playing, taking ownership
+        of it. It's started from the current position. */
+    void swapTo (PositionableAudioSource* newSource)
+    {
+        jassert (newSource != nullptr);
+
+        newSource->setLooping (looping);
+
+        if (isPrepared)
+            newSource->prepareToPlay (blockSize, sampleRate);
+
+        releaseRetiredSources();
+
+        // one that's still waiting was never heard, so it can just go
+        delete incoming.exchange (newSource);
+    }
+
+    /** Deletes the sources that have finished fading out. Call this now and
+        then on the message thread. */
+    void releaseRetiredSources()
+    {
+        delete retired.exchange (nullptr);
+    }
+
+    bool hasSource() const noexcept                     { return current.get() != nullptr; }
+
+    /** Sets how long the old and new sources overlap when swapping. */
+    void setCrossfadeMs (int newCrossfadeMs)            { crossfadeMs.set (jmax (0, newCrossfadeMs)); }
+    int getCrossfadeMs() const noexcept                 { return crossfadeMs.get(); }
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double newSampleRate) override
+    {
+        blockSize = samplesPerBlockExpected;
+        sampleRate = newSampleRate;
+        isPrepared = true;
+
+        scratch.setSize (2, jmax (samplesPerBlockExpected, (int) minScratchSize));
+
+        if (PositionableAudioSource* source = current.get())
+            source->prepareToPlay (samplesPerBlockExpected, newSampleRate);
+
+        if (fadingOut != nullptr)
+            fadingOut->prepareToPlay (samplesPerBlockExpected, newSampleRate);
+    }
+
+    void releaseResources() override
+    {
+        isPrepared = false;
+
+        if (PositionableAudioSource* source = current.get())
+            source->releaseResources();
+
+        if (fadingOut != nullptr)
+            fadingOut->releaseResources();
+    }
+
+    void getNextAudioBlock (const AudioSourceChannelInfo& info) override
+    {
+        takeIncomingSource();
+
+        PositionableAudioSource* const source = current.get();
+
+        if (source == nullptr)
+        {
+            info.clearActiveBufferRegion();
+            return;
+        }
+
+        source->getNextAudioBlock (info);
+
+        if (fadingOut == nullptr)
+            return;
+
+        for (int done = 0; done < info.numSamples && fadePosition < fadeLength;)
+        {
+            const int num = jmin (info.numSamples - done, scratch.getNumSamples(), fadeLength - fadePosition);
+            mixInFadingSource (info, done, num);
+            done += num;
+        }
+
+        // keep hold of it until the message thread has taken the last one
+        if (fadePosition >= fadeLength && retired.get() == nullptr)
+        {
+            retired.set (fadingOut);
+            fadingOut = nullptr;
+        }
+    }
+
+    //==============================================================================
+    void setNextReadPosition (int64 newPosition) override
+    {
+        if (PositionableAudioSource* source = current.get())
+            source->setNextReadPosition (newPosition);
+
+        // a seek in the middle of a fade cuts straight to the new source
+        fadePosition = fadeLength;
+    }
+
+    int64 getNextReadPosition() const override
+    {
+        const PositionableAudioSource* source = current.get();
+        return source != nullptr ? source->getNextReadPosition() : 0;
+    }
+
+    int64 getTotalLength() const override
+    {
+        const PositionableAudioSource* source = current.get();
+        return source != nullptr ? source->getTotalLength() : 0;
+    }
+
+    bool isLooping() const override                     { return looping; }
+
+    void setLooping (bool shouldLoop) override
+    {
+        looping = shouldLoop;
+
+        if (PositionableAudioSource* source = current.get())
+            source->setLooping (shouldLoop);
+    }
+
+private:
+    //==============================================================================
+    enum
+    {
+        defaultCrossfadeMs = 100,
+        minScratchSize = 8192
+    };
+
+    void takeIncomingSource() noexcept
+    {
+        if (fadingOut != nullptr || incoming.get() == nullptr)
+            return;
+
+        PositionableAudioSource* const newSource = incoming.exchange (nullptr);
+        PositionableAudioSource* const oldSource = current.get();
+
+        if (oldSource != nullptr)
+            newSource->setNextReadPosition (oldSource->getNextReadPosition());
+
+        current.set (newSource);
+        fadingOut = oldSource;
+        fadePosition = 0;
+        fadeLength = (int) (sampleRate * crossfadeMs.get() / 1000.0);
+    }
+
+    // The new source has already been rendered into the destination. It's
+    // faded in there, and the old one is read into the scratch buffer, faded
+    // out, and added on top.
+    void mixInFadingSource (const AudioSourceChannelInfo& info, int offset, int num)
+    {
+        const float startGain = fadePosition / (float) fadeLength;
+        const float endGain = (fadePosition + num) / (float) fadeLength;
+        const int start = info.startSample + offset;
+
+        AudioSourceChannelInfo fadeInfo (&scratch, 0, num);
+        fadingOut->getNextAudioBlock (fadeInfo);
+
+        info.buffer->applyGainRamp (start, num, startGain, endGain);
+
+        for (int ch = 0; ch < jmin (info.buffer->getNumChannels(), scratch.getNumChannels()); ++ch)
+            info.buffer->addFromWithRamp (ch, start, scratch.getReadPointer (ch), num, 1.0f - startGain, 1.0f - endGain);
+
+        fadePosition += num;
+    }
+
+    //==============================================================================
+    Atomic<PositionableAudioSource*> current, incoming, retired;
+    Atomic<int> crossfadeMs;
+
+    // only touched by the thread pulling audio, while playing
+    PositionableAudioSource* fadingOut = nullptr;
+    int fadePosition = 0, fadeLength = 0;
+    AudioSampleBuffer scratch;
+
+    bool looping = false, isPrepared = false;
+    int blockSize = 0;
+    double sampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HotSwapAudioSource)
+};
+
+#endif  // HOTSWAPAUDIOSOURCE_H_INCLUDED
@@ -0,0 +1,118 @@
+#ifndef LATENCYMONITOR_H_INCLUDED
+#define LATENCYMONITOR_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Measures how regularly the audio device calls us back.
+
+    audioCallbackStarted() is called at the top of every audio block and compares
+    the time since the previous callback with the nominal block period. The
+    deviation is smoothed into a running jitter estimate (the same 1/16 filter
+    RTP uses for inter-arrival jitter), and callbacks arriving more than half a
+    period late are counted, since those are the ones that lead to dropouts.
+
+    Only the audio thread writes to the statistics; the GUI polls getStats() and
+    can ask for them to be cleared with resetStatistics().
+*/
+class LatencyMonitor
+{
+public:
+    struct Stats
+    {
+        double sampleRate;
+        int bufferSize;
+        double outputLatencyMs;
+        float meanJitterMs, maxJitterMs;
+        int lateCallbacks, numCallbacks;
+    };
+
+    LatencyMonitor() {}
+
+    void prepare (double newSampleRate, int expectedBlockSize)
+    {
+        sampleRate = newSampleRate;
+        blockSize = expectedBlockSize;
+        clearStatistics();
+    }
+
+    /** Asks the audio thread to clear the figures at the start of its next block. */
+    void resetStatistics()
+    {
+        resetPending.set (1);
+    }
+
+    /** Called on the audio thread at the start of each block. */
+    void audioCallbackStarted (int numSamples) noexcept
+    {
+        if (resetPending.compareAndSetBool (0, 1))
+            clearStatistics();
+
+        const int64 now = Time::getHighResolutionTicks();
+        const int64 previous = lastCallbackTicks;
+        lastCallbackTicks = now;
+
+        if (previous == 0 || sampleRate <= 0.0)
+            return;
+
+        const double intervalMs = Time::highResolutionTicksToSeconds (now - previous) * 1000.0;
+        const double expectedMs = numSamples * 1000.0 / sampleRate;
+        const double deviationMs = std::abs (intervalMs - expectedMs);
+
+        smoothedJitterMs += (deviationMs - smoothedJitterMs) / 16.0;
+        meanJitter.set ((float) smoothedJitterMs);
+
+        if (deviationMs > maxJitter.get())
+            maxJitter.set ((float) deviationMs);
+
+        if (intervalMs > expectedMs * 1.5)
+            ++lateCallbacks;
+
+        ++numCallbacks;
+    }
+
+    /** Called on the message thread. */
+    Stats getStats (AudioIODevice* device) const
+    {
+        Stats stats = { sampleRate, blockSize, 0.0,
+                        meanJitter.get(), maxJitter.get(),
+                        lateCallbacks.get(), numCallbacks.get() };
+
+        if (device != nullptr && device->isOpen())
+        {
+            stats.sampleRate = device->getCurrentSampleRate();
+            stats.bufferSize = device->getCurrentBufferSizeSamples();
+
+            if (stats.sampleRate > 0.0)
+                stats.outputLatencyMs = (device->getOutputLatencyInSamples() + stats.bufferSize)
+                                            * 1000.0 / stats.sampleRate;
+        }
+
+        return stats;
+    }
+
+private:
+    void clearStatistics() noexcept
+    {
+        lastCallbackTicks = 0;
+        smoothedJitterMs = 0.0;
+        meanJitter.set (0.0f);
+        maxJitter.set (0.0f);
+        lateCallbacks.set (0);
+        numCallbacks.set (0);
+    }
+
+    double sampleRate = 0.0;
+    int blockSize = 0;
+
+    int64 lastCallbackTicks = 0;
+    double smoothedJitterMs = 0.0;
+
+    Atomic<float> meanJitter, maxJitter;
+    Atomic<int> lateCallbacks, numCallbacks, resetPending;
+
+    JUCE_DECLARE_NON_COPYABLE (LatencyMonitor)
+};
+
+#endif  // LATENCYMONITOR_H_INCLUDED
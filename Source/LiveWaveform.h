@@ -0,0 +1,275 @@
+#ifndef LIVEWAVEFORM_H_INCLUDED
+#define LIVEWAVEFORM_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FrameScheduler.h"
+#include "Tracer.h"
+
+//==============================================================================
+/*
+    A waveform of the incoming audio that grows as it arrives.
+
+    The audio thread reduces the input to a min/max pair for every few hundred
+    samples and pushes the pairs into a lock-free ring. Each frame drains the
+    ring and merges the pairs into one column per pixel, drawing each new
+    column into a single-channel Image and repainting only the columns that
+    changed.
+
+    When the waveform reaches the right-hand edge, neighbouring columns are
+    merged so that the whole recording fits in half the width. That redraws
+    everything, but it only happens each time the length doubles.
+*/
+class LiveWaveform : public Component,
+                     public FrameScheduler::Client
+{
+public:
+    LiveWaveform()
+       : fifo (ringSize)
+    {
+        setOpaque (true);
+    }
+
+    //==============================================================================
+    /** Clears the waveform and starts accepting samples. */
+    void start()
+    {
+        active.set (0);
+        fifo.finishedRead (fifo.getNumReady());
+        resetRequested.set (1);
+
+        columns.clearQuick();
+        samplesPerColumn = samplesPerPair;
+        pending = Column();
+        numPairsPending = 0;
+        redrawAll();
+
+        active.set (1);
+    }
+
+    void stop()
+    {
+        active.set (0);
+
+        if (update())
+            repaint();
+    }
+
+    bool isAnimating() override                 { return active.get() != 0; }
+
+    void advanceFrame (FrameScheduler& scheduler) override
+    {
+        const int firstChanged = columns.size();
+
+        if (update())
+            scheduler.invalidate (*this, Rectangle<int> (firstChanged, 0, columns.size() - firstChanged, getHeight()));
+    }
+
+    /** Called on the audio thread. Does nothing unless start() has been called. */
+    void pushSamples (const AudioSampleBuffer& buffer, int startSample, int numSamples) noexcept
+    {
+        if (active.get() == 0)
+            return;
+
+        if (resetRequested.compareAndSetBool (0, 1))
+        {
+            accumulator = Column();
+            numAccumulated = 0;
+        }
+
+        // each span runs up to the end of the pair being accumulated
+        for (int done = 0; done < numSamples;)
+        {
+            const int num = jmin (numSamples - done, samplesPerPair - numAccumulated);
+
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            {
+                Column span;
+                FloatVectorOperations::findMinimumAndMaximum (buffer.getReadPointer (ch, startSample + done),
+                                                              num, span.min, span.max);
+                accumulator.add (span);
+            }
+
+            done += num;
+            numAccumulated += num;
+
+            if (numAccumulated == samplesPerPair)
+            {
+                int start1, size1, start2, size2;
+                fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+                // if the GUI has fallen this far behind, the pair is lost
+                if (size1 > 0)
+                {
+                    ring[start1] = accumulator;
+                    fifo.finishedWrite (1);
+                }
+
+                accumulator = Column();
+                numAccumulated = 0;
+            }
+        }
+    }
+
+    //==============================================================================
+    void paint (Graphics& g) override
+    {
+        g.fillAll (Colours::black);
+
+        g.setColour (Colours::darkgrey);
+        g.drawHorizontalLine (getHeight() / 2, 0.0f, (float) getWidth());
+
+        g.setColour (Colours::orangered);
+        g.drawImageAt (image, 0, 0, true);
+    }
+
+    void resized() override
+    {
+        while (columns.size() > getWidth() && getWidth() > 0)
+            halveResolution();
+
+        redrawAll();
+    }
+
+private:
+    //==============================================================================
+    struct Column
+    {
+        float min = 1.0f, max = -1.0f;
+
+        void add (const Column& other) noexcept
+        {
+            min = jmin (min, other.min);
+            max = jmax (max, other.max);
+        }
+    };
+
+    enum
+    {
+        samplesPerPair = 256,
+        ringSize = 4096     // about 20 seconds of pairs at 48 kHz
+    };
+
+    // Drains the ring into the image. Returns true if the new columns still
+    // need repainting, or false if nothing arrived or everything was redrawn.
+    bool update()
+    {
+        TRACE_SCOPE ("Live waveform update");
+
+        const int numReady = fifo.getNumReady();
+
+        if (numReady == 0)
+            return false;
+
+        const int firstChanged = columns.size();
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)     addPair (ring[start1 + i]);
+        for (int i = 0; i < size2; ++i)     addPair (ring[start2 + i]);
+
+        fifo.finishedRead (size1 + size2);
+
+        if (needsFullRepaint)
+        {
+            needsFullRepaint = false;
+            redrawAll();
+            return false;
+        }
+
+        for (int x = firstChanged; x < columns.size(); ++x)
+            drawColumn (x);
+
+        return true;
+    }
+
+    void addPair (const Column& pair)
+    {
+        pending.add (pair);
+
+        if (++numPairsPending < samplesPerColumn / samplesPerPair)
+            return;
+
+        columns.add (pending);
+        pending = Column();
+        numPairsPending = 0;
+
+        if (columns.size() >= getWidth() && getWidth() > 1)
+        {
+            halveResolution();
+            needsFullRepaint = true;
+        }
+    }
+
+    void halveResolution()
+    {
+        Array<Column> merged;
+
+        for (int i = 0; i + 1 < columns.size(); i += 2)
+        {
+            Column c (columns.getReference (i));
+            c.add (columns.getReference (i + 1));
+            merged.add (c);
+        }
+
+        // an odd column left over becomes the start of the next one
+        if (columns.size() % 2 != 0)
+        {
+            pending.add (columns.getLast());
+            numPairsPending += samplesPerColumn / samplesPerPair;
+        }
+
+        columns.swapWith (merged);
+        samplesPerColumn *= 2;
+    }
+
+    void redrawAll()
+    {
+        if (getWidth() > 0 && getHeight() > 0)
+            image = Image (Image::SingleChannel, getWidth(), getHeight(), true);
+        else
+            image = Image();
+
+        for (int x = 0; x < columns.size(); ++x)
+            drawColumn (x);
+
+        repaint();
+    }
+
+    void drawColumn (int x)
+    {
+        if (image.isNull() || x >= image.getWidth())
+            return;
+
+        const Column& c = columns.getReference (x);
+        const float halfHeight = image.getHeight() * 0.5f;
+
+        const int top    = jlimit (0, image.getHeight() - 1, (int) (halfHeight - jmin (1.0f, c.max) * halfHeight));
+        const int bottom = jlimit (0, image.getHeight() - 1, (int) (halfHeight - jmax (-1.0f, c.min) * halfHeight));
+
+        const Image::BitmapData bitmap (image, x, 0, 1, image.getHeight(), Image::BitmapData::writeOnly);
+
+        for (int y = 0; y < bitmap.height; ++y)
+            *bitmap.getPixelPointer (0, y) = (uint8) (y >= top && y <= bottom ? 255 : 0);
+    }
+
+    //==============================================================================
+    AbstractFifo fifo;
+    Column ring[ringSize];
+    Atomic<int> active, resetRequested;
+
+    // only touched by the audio thread
+    Column accumulator;
+    int numAccumulated = 0;
+
+    // only touched by the message thread
+    Array<Column> columns;
+    Column pending;
+    int numPairsPending = 0, samplesPerColumn = samplesPerPair;
+    bool needsFullRepaint = false;
+    Image image;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LiveWaveform)
+};
+
+#endif  // LIVEWAVEFORM_H_INCLUDED
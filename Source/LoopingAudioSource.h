@@ -0,0 +1,443 @@
+#ifndef LOOPINGAUDIOSOURCE_H_INCLUDED
+#define LOOPINGAUDIOSOURCE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DecodedBlockCache.h"
+
+//==============================================================================
+/*
+    Plays an AudioTransportSource and, when a loop region is set, wraps around
+    from the end of the region back to its start at an exact sample position.
+
+    When the region is set, the first half-second of it (or all of it, for short
+    loops) is decoded into memory on the transport's read-ahead thread, which
+    then hands the region to the audio thread. Until then, playback carries on
+    with the previous region. The last few milliseconds before the loop end
+    are crossfaded with the start of that buffer, and playback carries on from
+    the buffer while the read-ahead thread refills from the point where the
+    buffer runs out. The wrap itself therefore never has to wait for the disk
+    or for a seek to complete. A region that arrives while the old one's buffer
+    is still playing doesn't interrupt it either: the old buffer plays out
+    first, since that's what the transport has been refilling behind.
+
+    All seeks should go through setPosition(), which hands them to the thread
+    that is pulling audio, so that they can't race with a wrap.
+*/
+class LoopingAudioSource : public AudioSource,
+                           private TimeSliceClient
+{
+public:
+    LoopingAudioSource (AudioTransportSource& transportToUse, DecodedBlockCache& cacheToUse,
+                        TimeSliceThread& threadToUse)
+       : transport (transportToUse),
+         blockCache (cacheToUse),
+         thread (threadToUse)
+    {
+        thread.addTimeSliceClient (this);
+    }
+
+    ~LoopingAudioSource()
+    {
+        thread.removeTimeSliceClient (this);
+    }
+
+    //==============================================================================
+    /** Tells the source which file the transport is playing, so that loop starts
+        can be decoded from it. This also clears any loop region, and unless the
+        new file is being crossfaded in mid-playback, returns to the start. */
+    void setFile (const File& file, bool returnToStart = true)
+    {
+        ScopedPointer<AudioFormatReader> newReader (blockCache.createReaderFor (file));
+
+        {
+            const ScopedLock sl (readerLock);
+            preloadReader.swapWith (newReader);
+        }
+
+        setLoopRange (Range<double>());
+
+        if (returnToStart)
+            setPosition (0.0);
+    }
+
+    /** Sets the region to loop, in seconds. An empty range turns looping off
+        straight away; a new region takes over once its start has been decoded. */
+    void setLoopRange (Range<double> newRange)
+    {
+        loopRange = newRange;
+
+        ScopedPointer<LoopRegion> newRegion (new LoopRegion());
+
+        if (! newRange.isEmpty() && sampleRate > 0.0)
+        {
+            newRegion->start = (int64) (newRange.getStart() * sampleRate);
+            newRegion->end   = (int64) (newRange.getEnd()   * sampleRate);
+
+            const int crossfade = getCrossfadeLength();
+
+            if (newRegion->getLength() > 2 * crossfade)
+            {
+                const int numToPreload = (int) jmin (newRegion->getLength(),
+                                                     (int64) (sampleRate * preloadMs / 1000));
+                newRegion->crossfade = crossfade;
+                newRegion->loopStart.setSize (2, numToPreload);
+                newRegion->loopStart.clear();
+
+                const ScopedLock sl (requestLock);
+                regionToDecode = newRegion;
+                decodeSampleRate = sampleRate;
+                ++requestVersion;
+
+                thread.moveToFrontOfQueue (this);
+                return;
+            }
+
+            newRegion->start = newRegion->end = 0;
+        }
+
+        // this also stops a region that's still being decoded from being published
+        const ScopedLock sl (requestLock);
+        regionToDecode = nullptr;
+        ++requestVersion;
+
+        publishRegion (newRegion);
+    }
+
+    /** Returns the loop region most recently passed to setLoopRange(). */
+    Range<double> getLoopRange() const noexcept     { return loopRange; }
+
+    /** Returns the loop region that playback is actually wrapping around, in
+        seconds. Unlike getLoopRange(), this can be called from any thread. */
+    Range<double> getActiveLoopRange() const noexcept
+    {
+        return sampleRate > 0.0 ? Range<double> (activeLoopStart.get() / sampleRate, activeLoopEnd.get() / sampleRate)
+                                : Range<double>();
+    }
+
+    /** Moves the playback position, in seconds. */
+    void setPosition (double newPosition)
+    {
+        if (sampleRate <= 0.0)
+        {
+            transport.setPosition (newPosition);
+            return;
+        }
+
+        const int64 samplePosition = jmax ((int64) 0, (int64) (newPosition * sampleRate));
+        currentPosition.set (samplePosition);
+        pendingSeek.set (samplePosition);
+    }
+
+    /** Returns the position of the next sample to be read, in seconds. */
+    double getCurrentPosition() const noexcept
+    {
+        return sampleRate > 0.0 ? currentPosition.get() / sampleRate
+                                : transport.getCurrentPosition();
+    }
+
+    double getLengthInSeconds() const               { return transport.getLengthInSeconds(); }
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double newSampleRate) override
+    {
+        transport.prepareToPlay (samplesPerBlockExpected, newSampleRate);
+
+        const double oldSampleRate = sampleRate;
+        sampleRate = newSampleRate;
+
+        position = transport.getNextReadPosition();
+        currentPosition.set (position);
+        readingLoopStart = false;
+        loopStartRegion = nullptr;
+        wasPlaying = false;
+
+        // loop positions and the decoded loop start are both in device samples
+        if (oldSampleRate != newSampleRate)
+            setLoopRange (loopRange);
+    }
+
+    void releaseResources() override
+    {
+        transport.releaseResources();
+    }
+
+    void getNextAudioBlock (const AudioSourceChannelInfo& info) override
+    {
+        updateRegion();
+
+        const int64 seek = pendingSeek.get();
+
+        if (seek >= 0 && pendingSeek.compareAndSetBool (-1, seek))
+        {
+            transport.setNextReadPosition (seek);
+            position = seek;
+            readingLoopStart = false;
+        }
+
+        if (! transport.isPlaying())
+        {
+            if (readingLoopStart && wasPlaying)
+            {
+                // the transport fades itself out when stopped, but it isn't the one
+                // making the sound at the moment, so do the same for the loop buffer
+                readLoopStart (info.buffer, info.startSample, info.numSamples);
+                info.buffer->applyGainRamp (info.startSample, info.numSamples, 1.0f, 0.0f);
+            }
+            else
+            {
+                transport.getNextAudioBlock (info);
+
+                if (! readingLoopStart)
+                    position = transport.getNextReadPosition();
+            }
+
+            wasPlaying = false;
+            currentPosition.set (position);
+            return;
+        }
+
+        wasPlaying = true;
+
+        for (int done = 0; done < info.numSamples;)
+            done += renderSection (info.buffer, info.startSample + done, info.numSamples - done);
+
+        currentPosition.set (position);
+    }
+
+private:
+    //==============================================================================
+    struct LoopRegion
+    {
+        int64 start = 0, end = 0;
+        int crossfade = 0;
+        AudioSampleBuffer loopStart;    // the first samples of the region
+
+        int64 getLength() const noexcept    { return end - start; }
+        bool isActive() const noexcept      { return end > start; }
+    };
+
+    enum
+    {
+        preloadMs = 500,
+        crossfadeMs = 5
+    };
+
+    int getCrossfadeLength() const noexcept
+    {
+        return jmax (1, (int) (sampleRate * crossfadeMs / 1000));
+    }
+
+    int useTimeSlice() override
+    {
+        ScopedPointer<LoopRegion> newRegion;
+        double rate;
+        int version;
+
+        {
+            const ScopedLock sl (requestLock);
+
+            if (regionToDecode == nullptr)
+                return 50;
+
+            newRegion = regionToDecode;
+            rate = decodeSampleRate;
+            version = requestVersion;
+        }
+
+        {
+            const ScopedLock sl (readerLock);
+            decodeLoopStart (*newRegion, rate);
+        }
+
+        const ScopedLock sl (requestLock);
+
+        // dropped if setLoopRange() has been called again in the meantime
+        if (version == requestVersion)
+            publishRegion (newRegion);
+
+        return 0;
+    }
+
+    // Runs on the read-ahead thread, under readerLock, using a reader of its own
+    // so that it never touches the one the transport is playing from. Both read
+    // through the block cache, so the loop start is usually already decoded.
+    void decodeLoopStart (LoopRegion& target, double rate)
+    {
+        if (preloadReader == nullptr || preloadReader->sampleRate <= 0.0)
+            return;
+
+        AudioFormatReaderSource readerSource (preloadReader, false);
+        ResamplingAudioSource resampler (&readerSource, false, 2);
+        resampler.setResamplingRatio (preloadReader->sampleRate / rate);
+
+        const int blockSize = 4096;
+        const int numSamples = target.loopStart.getNumSamples();
+        resampler.prepareToPlay (blockSize, rate);
+        readerSource.setNextReadPosition ((int64) (target.start * preloadReader->sampleRate / rate));
+
+        for (int pos = 0; pos < numSamples; pos += blockSize)
+            resampler.getNextAudioBlock (AudioSourceChannelInfo (&target.loopStart, pos,
+                                                                 jmin (blockSize, numSamples - pos)));
+
+        resampler.releaseResources();
+    }
+
+    // Called under requestLock.
+    void publishRegion (ScopedPointer<LoopRegion>& newRegion)
+    {
+        // whatever was pending is deleted here, never on the audio thread
+        const SpinLock::ScopedLockType lock (regionLock);
+        pendingRegion = newRegion;
+        regionChanged.set (1);
+    }
+
+    void updateRegion() noexcept
+    {
+        if (regionChanged.get() == 0)
+            return;
+
+        const SpinLock::ScopedTryLockType lock (regionLock);
+
+        if (! lock.isLocked())
+            return;
+
+        // the old region is left in pendingRegion to be deleted by the next publishRegion()
+        region.swapWith (pendingRegion);
+        regionChanged.set (0);
+
+        activeLoopStart.set (region->start);
+        activeLoopEnd.set (region->end);
+
+        // If the old region's loop start is still playing, it's kept until it has
+        // played out, as the transport is already reading from where it ends.
+        // Any region kept from before that is finished with and goes instead.
+        if (readingLoopStart && loopStartRegion == pendingRegion.get())
+            previousRegion.swapWith (pendingRegion);
+    }
+
+    // Renders as much of the block as it can without crossing a loop boundary
+    // or the end of the decoded loop start, and returns the number of samples done.
+    int renderSection (AudioSampleBuffer* buffer, int startSample, int numSamples)
+    {
+        const bool looping = region != nullptr && region->isActive() && position < region->end;
+        int num = numSamples;
+
+        if (readingLoopStart)
+            num = (int) jmin ((int64) num, loopStartRegion->start + loopStartRegion->loopStart.getNumSamples() - position);
+
+        if (! looping)
+        {
+            readPlain (buffer, startSample, num);
+            return num;
+        }
+
+        const int64 crossfadeStart = region->end - region->crossfade;
+
+        if (position < crossfadeStart)
+        {
+            num = (int) jmin ((int64) num, crossfadeStart - position);
+            readPlain (buffer, startSample, num);
+            return num;
+        }
+
+        num = (int) jmin ((int64) num, region->end - position);
+
+        const int fadeIndex = (int) (position - crossfadeStart);
+        const float fadeStep = 1.0f / (float) region->crossfade;
+        const float fadeIn  = fadeIndex * fadeStep;
+        const float fadeOut = 1.0f - fadeIn;
+        const float fadeInEnd = (fadeIndex + num) * fadeStep;
+
+        readPlain (buffer, startSample, num);
+        buffer->applyGainRamp (startSample, num, fadeOut, 1.0f - fadeInEnd);
+
+        for (int ch = 0; ch < buffer->getNumChannels(); ++ch)
+            buffer->addFromWithRamp (ch, startSample,
+                                     region->loopStart.getReadPointer (ch % region->loopStart.getNumChannels(), fadeIndex),
+                                     num, fadeIn, fadeInEnd);
+
+        if (position == region->end)
+        {
+            position = region->start + region->crossfade;
+            readingLoopStart = true;
+            loopStartRegion = region;
+
+            // Point the transport at the end of the decoded buffer now, so that its
+            // read-ahead thread has the whole buffer's length to catch up.
+            if (region->loopStart.getNumSamples() < region->getLength())
+                transport.setNextReadPosition (region->start + region->loopStart.getNumSamples());
+        }
+
+        return num;
+    }
+
+    void readPlain (AudioSampleBuffer* buffer, int startSample, int numSamples)
+    {
+        if (readingLoopStart)
+        {
+            readLoopStart (buffer, startSample, numSamples);
+            position += numSamples;
+
+            if (position - loopStartRegion->start >= loopStartRegion->loopStart.getNumSamples())
+                readingLoopStart = false;
+        }
+        else
+        {
+            // Counted here rather than read back from the transport, which rounds
+            // through the file's sample rate and could step over the loop end.
+            transport.getNextAudioBlock (AudioSourceChannelInfo (buffer, startSample, numSamples));
+            position += numSamples;
+        }
+    }
+
+    void readLoopStart (AudioSampleBuffer* buffer, int startSample, int numSamples) noexcept
+    {
+        const AudioSampleBuffer& source = loopStartRegion->loopStart;
+        const int offset = (int) (position - loopStartRegion->start);
+        const int numAvailable = jlimit (0, numSamples, source.getNumSamples() - offset);
+
+        for (int ch = 0; ch < buffer->getNumChannels(); ++ch)
+        {
+            if (numAvailable > 0)
+                buffer->copyFrom (ch, startSample, source, ch % source.getNumChannels(), offset, numAvailable);
+
+            if (numAvailable < numSamples)
+                buffer->clear (ch, startSample + numAvailable, numSamples - numAvailable);
+        }
+    }
+
+    //==============================================================================
+    AudioTransportSource& transport;
+    DecodedBlockCache& blockCache;
+    TimeSliceThread& thread;
+
+    CriticalSection readerLock;
+    ScopedPointer<AudioFormatReader> preloadReader;
+
+    double sampleRate = 0.0;
+    Range<double> loopRange;
+
+    // a region waiting for the read-ahead thread to decode its loop start
+    CriticalSection requestLock;
+    ScopedPointer<LoopRegion> regionToDecode;
+    double decodeSampleRate = 0.0;
+    int requestVersion = 0;
+
+    SpinLock regionLock;
+    ScopedPointer<LoopRegion> region, pendingRegion;
+    Atomic<int> regionChanged;
+    Atomic<int64> activeLoopStart, activeLoopEnd;
+
+    Atomic<int64> pendingSeek { -1 }, currentPosition;
+
+    // only touched by the thread pulling audio
+    ScopedPointer<LoopRegion> previousRegion;
+    LoopRegion* loopStartRegion = nullptr;     // region or previousRegion, while readingLoopStart
+    int64 position = 0;
+    bool readingLoopStart = false;
+    bool wasPlaying = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoopingAudioSource)
+};
+
+#endif  // LOOPINGAUDIOSOURCE_H_INCLUDED
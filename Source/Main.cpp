@@ -9,6 +9,7 @@
 */
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "StartupProfiler.h"
 
 Component* createMainContentComponent();
 
@@ -27,8 +28,10 @@ public:
     void initialise (const String& commandLine) override
     {
         // This method is where you should put your application's initialisation code..
+        StartupProfiler::getInstance().start();
 
         mainWindow = new MainWindow (getApplicationName());
+        StartupProfiler::getInstance().markPhase ("main window shown");
     }
 
     void shutdown() override
@@ -68,6 +71,7 @@ public:
         {
             setUsingNativeTitleBar (true);
             setContentOwned (createMainContentComponent(), true);
+            StartupProfiler::getInstance().markPhase ("content component created");
             setResizable (true, true);
 
             centreWithSize (getWidth(), getHeight());
@@ -0,0 +1,1074 @@
+#ifndef MAINCOMPONENT_H_INCLUDED
+#define MAINCOMPONENT_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "StartupProfiler.h"
+#include "AudioSettingsPanel.h"
+#include "TimeStretchAudioSource.h"
+#include "LoopingAudioSource.h"
+#include "PositionOverlay.h"
+#include "ScrubAudioSource.h"
+#include "Goniometer.h"
+#include "DecodedBlockCache.h"
+#include "PreloadedClipCache.h"
+#include "TransportCommandQueue.h"
+#include "PlayheadClock.h"
+#include "AudioRecorder.h"
+#include "LiveWaveform.h"
+#include "ProcessingChain.h"
+#include "ParametricEqPanel.h"
+#include "Chromagram.h"
+#include "WaveformRasterizer.h"
+#include "FrameScheduler.h"
+#include "FileOpener.h"
+#include "HotSwapAudioSource.h"
+#include "SilenceIndex.h"
+#include "SilenceSkippingAudioSource.h"
+#include "MarkerList.h"
+#include "RegionExporter.h"
+
+class MainContentComponent   : public AudioAppComponent,
+private ChangeListener,
+private ButtonListener,
+private Slider::Listener,
+private PositionOverlay::Listener,
+private TransportCommandQueue::Listener,
+private FrameScheduler::Client,
+private AsyncUpdater
+{
+public:
+    MainContentComponent()
+    : state (Stopped),
+    thumbnailCache (5),                            // [4]
+    thumbnail (512, formatManager, thumbnailCache), // [5]
+    positionOverlay (*this)
+    {
+        setLookAndFeel (&lookAndFeel);
+        
+        addAndMakeVisible (&openButton);
+        openButton.setButtonText ("Open...");
+        openButton.addListener (this);
+        
+        addAndMakeVisible (&settingsButton);
+        settingsButton.setButtonText ("Audio Settings...");
+        settingsButton.addListener (this);
+        
+        addAndMakeVisible (&recordButton);
+        recordButton.setButtonText ("Record");
+        recordButton.addListener (this);
+        recordButton.setColour (TextButton::buttonColourId, Colours::darkred);
+        
+        addAndMakeVisible (&exportButton);
+        exportButton.setButtonText ("Export...");
+        exportButton.addListener (this);
+        
+        addAndMakeVisible (&skipSilenceButton);
+        skipSilenceButton.setButtonText ("Skip silence");
+        skipSilenceButton.addListener (this);
+        
+        addAndMakeVisible (&eqButton);
+        eqButton.setButtonText ("EQ...");
+        eqButton.addListener (this);
+        
+        addAndMakeVisible (&playButton);
+        playButton.setButtonText ("Play");
+        playButton.addListener (this);
+        playButton.setColour (TextButton::buttonColourId, Colours::green);
+        playButton.setEnabled (false);
+        
+        addAndMakeVisible (&stopButton);
+        stopButton.setButtonText ("Stop");
+        stopButton.addListener (this);
+        stopButton.setColour (TextButton::buttonColourId, Colours::red);
+        stopButton.setEnabled (false);
+        
+        setSize (600, 400);
+        
+        addAndMakeVisible (levelSlider);
+        levelSlider.setRange(0,100);
+        levelSlider.setTextValueSuffix("vol");
+        levelSlider.setValue(50);
+        levelSlider.addListener (this);
+        
+        addAndMakeVisible (volumeLabel);
+        volumeLabel.setText("Volume", dontSendNotification);
+        volumeLabel.attachToComponent (&levelSlider, true);
+        
+        levelSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 160, levelSlider.getTextBoxHeight());
+        
+        addAndMakeVisible (speedSlider);
+        speedSlider.setRange (0.5, 2.0, 0.01);
+        speedSlider.setSkewFactorFromMidPoint (1.0);
+        speedSlider.setValue (1.0);
+        speedSlider.setDoubleClickReturnValue (true, 1.0);
+        speedSlider.setTextValueSuffix ("x");
+        speedSlider.setTextBoxStyle (Slider::TextBoxLeft, false, 160, speedSlider.getTextBoxHeight());
+        speedSlider.addListener (this);
+        
+        addAndMakeVisible (speedLabel);
+        speedLabel.setText ("Speed", dontSendNotification);
+        speedLabel.attachToComponent (&speedSlider, true);
+        
+        addAndMakeVisible (&positionOverlay);
+        addAndMakeVisible (&goniometer);
+        addChildComponent (&liveWaveform);
+        
+        frameScheduler.addClient (this);
+        frameScheduler.addClient (&goniometer);
+        frameScheduler.addClient (&liveWaveform);
+        
+        // the EQ sits before the gain, and is bypassed until a band is switched on
+        processingChain.addProcessor (eqProcessor = new ParametricEqProcessor());
+        processingChain.setBypassed (eqNodeIndex, true);
+        processingChain.addProcessor (gainProcessor = new GainProcessor());
+        gainProcessor->setGain ((float) levelSlider.getValue());
+        
+        // M adds a marker at the playhead; the arrow keys jump between markers
+        setWantsKeyboardFocus (true);
+        
+        thumbnail.addChangeListener (this);            // [6]
+        clipCache.addChangeListener (this);
+        fileOpener.addChangeListener (this);
+        
+        // The format manager, the audio device and the frame scheduler are only
+        // brought up after the first frame has been painted - see initialiseSubsystems().
+    }
+    
+    ~MainContentComponent()
+    {
+        cancelPendingUpdate();
+        settingsWindow.deleteAndZero();
+        eqWindow.deleteAndZero();
+        deviceManager.removeChangeListener (this);
+        setLookAndFeel(nullptr);
+        shutdownAudio();
+        transportSource.setSource (nullptr);
+        
+        clipCache.removeChangeListener (this);
+        fileOpener.removeChangeListener (this);
+        
+        if (playbackSlot.hasSource())
+        {
+            Logger::writeToLog (blockCache.getStatisticsDescription());
+            Logger::writeToLog (clipCache.getStatisticsDescription());
+        }
+    }
+    
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override
+    {
+        latencyMonitor.prepare (sampleRate, samplesPerBlockExpected);
+        
+        // there's no device when a HeadlessAudioDevice is pulling the output
+        AudioIODevice* device = deviceManager.getCurrentAudioDevice();
+        const int outputLatency = device != nullptr ? device->getOutputLatencyInSamples() : 0;
+        playheadClock.prepare (sampleRate, outputLatency + samplesPerBlockExpected);
+        
+        timeStretch.prepareToPlay (samplesPerBlockExpected, sampleRate);
+        transportCommands.prepareToPlay (sampleRate);
+        processingChain.prepareToPlay (sampleRate, samplesPerBlockExpected, 2);
+        liveChroma.prepare (sampleRate);
+        scrubSource.prepareToPlay (samplesPerBlockExpected, sampleRate);
+    }
+    
+    void getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill) override
+    {
+        Tracer::setAudioThread();
+        TRACE_SCOPE ("getNextAudioBlock");
+        
+        latencyMonitor.audioCallbackStarted (bufferToFill.numSamples);
+        
+        // the buffer still holds the input at this point
+        recorder.pushInput (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+        liveWaveform.pushSamples (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+        
+        if (! playbackSlot.hasSource())
+        {
+            bufferToFill.clearActiveBufferRegion();
+            return;
+        }
+        
+        // While the playhead is being dragged the rest of the chain isn't pulled,
+        // so the transport stays where it was until the scrub ends.
+        if (scrubSource.isScrubbing())
+        {
+            playheadClock.publish (scrubSource.getCurrentPosition(), 0.0, Range<double>(), bufferToFill.numSamples);
+            scrubSource.getNextAudioBlock (bufferToFill);
+            transportCommands.skip (bufferToFill.numSamples);
+        }
+        else
+        {
+            // The stretcher renders ahead of the device, so the loop source is
+            // slightly ahead of the first sample of this block.
+            const double blockPosition = loopSource.getCurrentPosition() - timeStretch.getLookAheadSeconds();
+            
+            playheadClock.publish (blockPosition, transportCommands.isPlaying() ? timeStretch.getSpeed() : 0.0,
+                                   loopSource.getActiveLoopRange(), bufferToFill.numSamples);
+            
+            transportCommands.process (bufferToFill, timeStretch, *this);
+            
+            // the transport stops itself at the end of the file, and when it's
+            // given a new one
+            if (! transportSource.isPlaying())
+                transportCommands.sourceStopped();
+        }
+        
+        processingChain.process (bufferToFill);
+        
+        goniometer.pushSamples (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+        liveChroma.pushSamples (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+    }
+    
+    /** Loads a file without opening the audio device, so that a
+        HeadlessAudioDevice can pull the output instead. The file is read on the
+        audio thread rather than ahead of it, so that the output doesn't depend
+        on how far the read-ahead thread has got. That means the block cache
+        decodes on the device's callback, which only a headless device, with no
+        deadline to miss, can allow. */
+    bool loadFileHeadless (const File& file)
+    {
+        if (formatManager.getNumKnownFormats() == 0)
+            formatManager.registerBasicFormats();
+        
+        // painting mustn't bring up the real device either
+        firstFramePainted = true;
+        useReadAheadThread = false;
+        
+        // opened synchronously, since nothing else is waiting
+        useFile (file, blockCache.createReaderFor (file));
+        return playbackSlot.hasSource();
+    }
+    
+    bool startHeadlessPlayback (const File& file)
+    {
+        if (! loadFileHeadless (file))
+            return false;
+        
+        changeState (Starting);
+        return true;
+    }
+    
+    bool isThumbnailFullyLoaded() const     { return thumbnail.isFullyLoaded(); }
+    
+    void releaseResources() override
+    {
+        timeStretch.releaseResources();
+        scrubSource.releaseResources();
+        processingChain.releaseResources();
+    }
+    
+    void paint (Graphics& g) override
+    {
+        TRACE_SCOPE ("MainContentComponent paint");
+        
+        if (! firstFramePainted)
+        {
+            firstFramePainted = true;
+            StartupProfiler::getInstance().firstFramePainted();
+            triggerAsyncUpdate();
+        }
+        
+        const Rectangle<int> thumbnailBounds (getThumbnailBounds());
+        
+        if (thumbnail.getNumChannels() == 0)
+            paintIfNoFileLoaded (g, thumbnailBounds);
+        else
+            paintIfFileLoaded (g, thumbnailBounds);
+        
+        if (fileOpener.isOpening())
+            paintOpeningFile (g, thumbnailBounds);
+    }
+    
+    void resized() override
+    {
+        openButton.setBounds (10, 10, getWidth() - 550, 20);
+        exportButton.setBounds (getWidth() - 530, 10, 90, 20);
+        skipSilenceButton.setBounds (getWidth() - 430, 10, 100, 20);
+        recordButton.setBounds (getWidth() - 320, 10, 90, 20);
+        eqButton.setBounds (getWidth() - 220, 10, 90, 20);
+        settingsButton.setBounds (getWidth() - 120, 10, 110, 20);
+        playButton.setBounds (10, 40, getWidth() - 20, 20);
+        stopButton.setBounds (10, 70, getWidth() - 20, 20);
+        levelSlider.setBounds (10, 100, getWidth() - 20, 20);
+        speedSlider.setBounds (10, 130, getWidth() - 20, 20);
+        positionOverlay.setBounds (getOverviewBounds());
+        liveWaveform.setBounds (getThumbnailBounds());
+        goniometer.setBounds (getWidth() - 10 - goniometerWidth, 160, goniometerWidth, getHeight() - 250);
+    }
+    
+    void changeListenerCallback (ChangeBroadcaster* source) override
+    {
+        if (source == &thumbnail)       thumbnailChanged();
+        if (source == &deviceManager)   saveAudioDeviceSettings();
+        if (source == &clipCache)       clipPreloaded();
+        if (source == &fileOpener)      fileOpened();
+    }
+    
+    void buttonClicked (Button* button) override
+    {
+        if (button == &openButton)  openButtonClicked();
+        if (button == &settingsButton)  settingsButtonClicked();
+        if (button == &recordButton)  recordButtonClicked();
+        if (button == &exportButton)  exportButtonClicked();
+        if (button == &eqButton)  eqButtonClicked();
+        if (button == &skipSilenceButton)  silenceSkipper.setEnabled (skipSilenceButton.getToggleState());
+        if (button == &playButton)  playButtonClicked();
+        if (button == &stopButton)  stopButtonClicked();
+    }
+    
+    void sliderValueChanged (Slider* slider) override
+    {
+        if (slider == &speedSlider)
+            timeStretch.setSpeed (speedSlider.getValue());
+        
+        if (slider == &levelSlider)
+            gainProcessor->setGain ((float) levelSlider.getValue());
+    }
+    
+private:
+    Rectangle<int> getThumbnailBounds() const
+    {
+        return Rectangle<int> (10, 160, getWidth() - 30 - goniometerWidth, getHeight() - 250);
+    }
+    
+    // the whole file, with the position overlay on top of it
+    Rectangle<int> getOverviewBounds() const
+    {
+        return Rectangle<int> (10, getHeight() - 80, getWidth() - 20, 70);
+    }
+    
+    // Extrapolated from the audio thread's last block to the moment the frame is
+    // drawn, so the playhead moves smoothly rather than once per buffer.
+    double getHeardPosition() const
+    {
+        if (scrubSource.isScrubbing())
+            return scrubSource.getCurrentPosition();
+        
+        return jmax (0.0, playheadClock.getPosition());
+    }
+    
+    // The playhead moves while the transport runs or is being scrubbed, the
+    // spinner turns while a file is opening, and the chroma lane fills in while
+    // the file is being analysed, unless the analysis has failed. The transitional
+    // states count too, since they're resolved by polling the audio thread.
+    bool isAnimating() override
+    {
+        return (state != Stopped && state != Paused)
+                || scrubSource.isScrubbing()
+                || fileOpener.isOpening()
+                || (silenceIndex != nullptr && ! silenceIndex->isReady() && ! silenceIndex->hasFailed())
+                || (chromagram != nullptr && chromagram->getProgress() < 1.0 && ! chromagram->hasFailed());
+    }
+    
+    void advanceFrame (FrameScheduler& scheduler) override
+    {
+        TRACE_SCOPE ("MainContentComponent frame");
+        
+        updateTransportState();
+        playbackSlot.releaseRetiredSources();
+        liveChroma.update();
+        positionOverlay.setLength (transportSource.getLengthInSeconds());
+        positionOverlay.setPlayheadPosition (getHeardPosition());
+        playheadClock.measureFrame();
+        
+        // While recording, the live waveform covers the thumbnail and repaints
+        // just the columns that it adds.
+        if (! liveWaveform.isVisible())
+            scheduler.invalidate (*this, getThumbnailBounds());
+        
+        // the overview isn't redrawn every frame, so it needs telling
+        if (silenceIndex != nullptr && silenceIndex->isReady() && ! silenceShownOnOverview)
+        {
+            silenceShownOnOverview = true;
+            scheduler.invalidate (*this, getOverviewBounds());
+        }
+    }
+    
+    bool keyPressed (const KeyPress& key) override
+    {
+        if (! playbackSlot.hasSource())
+            return false;
+        
+        if (key == KeyPress ('m'))
+        {
+            markers.addUserMarker (getHeardPosition());
+            repaint (getThumbnailBounds());
+            repaint (getOverviewBounds());
+            return true;
+        }
+        
+        // Going back skips a marker that has only just been passed, so that
+        // pressing it repeatedly during playback keeps moving back.
+        if (key == KeyPress::leftKey)
+            return jumpToMarker (markers.getPreviousTime (getHeardPosition() - 0.5));
+        
+        if (key == KeyPress::rightKey)
+            return jumpToMarker (markers.getNextTime (getHeardPosition()));
+        
+        return false;
+    }
+    
+    bool jumpToMarker (double time)
+    {
+        if (time >= 0.0)
+            positionOverlayClicked (time);
+        
+        return true;
+    }
+    
+    void positionOverlayClicked (double newPosition) override
+    {
+        transportCommands.seek (newPosition);
+        frameScheduler.wake();
+    }
+    
+    // called on the audio thread, at the sample the seek was scheduled for
+    void transportSeekRequested (double newPosition) override
+    {
+        loopSource.setPosition (newPosition);
+        timeStretch.flush();
+    }
+    
+    void loopRangeChanged (Range<double> newLoopRange) override
+    {
+        loopSource.setLoopRange (newLoopRange);
+    }
+    
+    void scrubStarted (double position) override
+    {
+        scrubSource.beginScrub (position);
+        frameScheduler.wake();
+    }
+    
+    void scrubMoved (double position) override
+    {
+        scrubSource.setScrubPosition (position);
+    }
+    
+    void scrubEnded (double position) override
+    {
+        scrubSource.endScrub();
+        transportCommands.seek (position);
+    }
+    
+    void handleAsyncUpdate() override
+    {
+        initialiseSubsystems();
+    }
+    
+    // Opening the audio device can take tens of milliseconds (longer for duplex
+    // ALSA devices), so it is deferred until the window is already on screen.
+    void initialiseSubsystems()
+    {
+        if (subsystemsInitialised)
+            return;
+        
+        subsystemsInitialised = true;
+        StartupProfiler& profiler = StartupProfiler::getInstance();
+        
+        formatManager.registerBasicFormats();
+        readAheadThread.startThread (3);
+        profiler.markPhase ("audio formats registered");
+        
+        // Playback only: opening input channels as well would force a duplex
+        // device, which on many ALSA drivers means larger minimum buffers.
+        ScopedPointer<XmlElement> savedState (XmlDocument::parse (getAudioDeviceSettingsFile()));
+        setAudioChannels (0, 2, savedState);
+        deviceManager.addChangeListener (this);
+        profiler.markPhase ("audio device opened");
+        
+        frameScheduler.wake();
+    }
+    
+    static File getAudioDeviceSettingsFile()
+    {
+        return File::getSpecialLocation (File::userApplicationDataDirectory)
+                   .getChildFile (ProjectInfo::projectName)
+                   .getChildFile ("AudioDeviceSettings.xml");
+    }
+    
+    void saveAudioDeviceSettings()
+    {
+        ScopedPointer<XmlElement> state (deviceManager.createStateXml());
+        
+        if (state != nullptr)
+        {
+            const File file (getAudioDeviceSettingsFile());
+            file.getParentDirectory().createDirectory();
+            state->writeToFile (file, String());
+        }
+    }
+    
+    enum { goniometerWidth = 140, eqNodeIndex = 0, chromaLaneHeight = 48, liveChromaWidth = 8 };
+    
+    enum TransportState
+    {
+        Stopped,
+        Starting,
+        Playing,
+        Pausing,
+        Paused,
+        Stopping
+    };
+    
+    void changeState (TransportState newState)
+    {
+        if (state != newState)
+        {
+            state = newState;
+            frameScheduler.wake();
+            
+            switch (state)
+            {
+                case Stopped:
+                    playButton.setButtonText("Play");
+                    stopButton.setButtonText("Stop");
+                    stopButton.setEnabled (false);
+                    playButton.setEnabled (true);
+                    transportCommands.seek (0.0);
+                    break;
+                    
+                case Starting:
+                    // The transport itself is left running from here on; whether
+                    // it's heard is decided per sample by the command queue.
+                    playButton.setEnabled (false);
+                    transportSource.start();
+                    transportCommands.start();
+                    break;
+                    
+                case Playing:
+                    playButton.setButtonText("Pause");
+                    stopButton.setButtonText("Stop");
+                    stopButton.setEnabled (true);
+                    break;
+                    
+                case Pausing:
+                    transportCommands.stop();
+                    break;
+                    
+                case Paused:
+                    playButton.setButtonText("Resume");
+                    stopButton.setButtonText("Return to Zero");
+                    break;
+                    
+                case Stopping:
+                    transportCommands.stop();
+                    break;
+                    
+                default:
+                    jassertfalse;
+                    break;
+            }
+        }
+    }
+    
+    // Polled from the timer: the audio thread publishes whether it's playing,
+    // which covers commands it has applied as well as reaching the end of the file.
+    void updateTransportState()
+    {
+        if (transportCommands.isPlaying())
+        {
+            if (state == Starting)
+                changeState (Playing);
+        }
+        else if (state == Pausing)
+        {
+            changeState (Paused);
+        }
+        else if (state == Playing || state == Stopping)
+        {
+            changeState (Stopped);
+        }
+    }
+    
+    void thumbnailChanged()
+    {
+        repaint();
+    }
+    
+    void paintIfNoFileLoaded (Graphics& g, const Rectangle<int>& thumbnailBounds)
+    {
+        g.setColour (Colours::darkgrey);
+        g.fillRect (thumbnailBounds);
+        g.fillRect (getOverviewBounds());
+        g.setColour (Colours::white);
+        g.drawFittedText ("No File Loaded", thumbnailBounds, Justification::centred, 1.0f);
+    }
+    
+    void paintIfFileLoaded (Graphics& g, const Rectangle<int>& thumbnailBounds)
+    {
+        const double audioLen(thumbnail.getTotalLength());
+        const double audioPos (getHeardPosition());
+        
+        Rectangle<int> waveformBounds (thumbnailBounds);
+        const Rectangle<int> chromaBounds (waveformBounds.removeFromBottom (chromaLaneHeight));
+        
+        g.setColour (Colours::white);
+        g.fillRect (waveformBounds);
+        
+        g.setColour (Colours::red);                                     // [8]
+        
+        waveformRasterizer.draw (g, thumbnail,                          // [9]
+                                 waveformBounds,
+                                 audioPos,                                   // start time
+                                 audioPos+2,            // end time
+                                 1.0f);                                 // vertical zoom
+        
+        paintSilence (g, waveformBounds, audioPos, audioPos + 2);
+        markers.draw (g, waveformBounds, audioPos, audioPos + 2, true);
+        
+        {
+            TRACE_SCOPE ("Chroma lane");
+            paintChromaLane (g, chromaBounds, audioPos, audioPos + 2);
+        }
+        
+        const Rectangle<int> overviewBounds (getOverviewBounds());
+        g.setColour (Colours::white);
+        g.fillRect (overviewBounds);
+        g.setColour (Colours::red);
+        overviewRasterizer.draw (g, thumbnail, overviewBounds, 0.0, audioLen, 1.0f);
+        paintSilence (g, overviewBounds, 0.0, audioLen);
+        markers.draw (g, overviewBounds, 0.0, audioLen, false);
+    }
+    
+    // Shades the silent regions that playback skips when it's asked to.
+    void paintSilence (Graphics& g, const Rectangle<int>& area, double startTime, double endTime)
+    {
+        if (silenceIndex == nullptr)
+            return;
+        
+        g.setColour (Colours::steelblue.withAlpha (0.25f));
+        silenceIndex->draw (g, area, startTime, endTime);
+    }
+    
+    // Drawn over the current file, which carries on playing until the new one
+    // is ready to take its place.
+    void paintOpeningFile (Graphics& g, const Rectangle<int>& thumbnailBounds)
+    {
+        g.setColour (Colours::black.withAlpha (0.5f));
+        g.fillRect (thumbnailBounds);
+        
+        const Rectangle<int> spinnerBounds (thumbnailBounds.withSizeKeepingCentre (40, 40).translated (0, -15));
+        getLookAndFeel().drawSpinningWaitAnimation (g, Colours::white, spinnerBounds.getX(), spinnerBounds.getY(),
+                                                    spinnerBounds.getWidth(), spinnerBounds.getHeight());
+        
+        g.setColour (Colours::white);
+        g.drawFittedText ("Opening " + fileOpener.getFileBeingOpened().getFileName() + "...",
+                          thumbnailBounds.withTop (spinnerBounds.getBottom() + 5), Justification::centredTop, 1);
+    }
+    
+    // The file's chromagram over the same two seconds as the waveform, with
+    // what's being heard right now (after the EQ) in a strip at the left.
+    void paintChromaLane (Graphics& g, const Rectangle<int>& laneBounds, double startTime, double endTime)
+    {
+        g.setColour (Colours::black);
+        g.fillRect (laneBounds);
+        
+        Rectangle<int> area (laneBounds);
+        const Rectangle<int> liveArea (area.removeFromLeft (liveChromaWidth));
+        
+        if (chromagram != nullptr)
+        {
+            chromagram->draw (g, area, startTime, endTime);
+            
+            const double progress = chromagram->getProgress();
+            
+            if (progress < 1.0)
+            {
+                g.setColour (Colours::white);
+                g.drawText (chromagram->hasFailed() ? String ("Analysis failed")
+                                                    : "Analysing " + String (roundToInt (progress * 100.0)) + "%",
+                            area.reduced (4, 0), Justification::topRight);
+            }
+        }
+        
+        if (! transportCommands.isPlaying())
+            return;
+        
+        const float rowHeight = liveArea.getHeight() / (float) Chroma::numPitchClasses;
+        
+        for (int pitchClass = 0; pitchClass < Chroma::numPitchClasses; ++pitchClass)
+        {
+            g.setColour (Colour::fromHSV (pitchClass / (float) Chroma::numPitchClasses, 0.7f,
+                                          liveChroma.getLevel (pitchClass), 1.0f));
+            g.fillRect (Rectangle<float> ((float) liveArea.getX(), liveArea.getBottom() - (pitchClass + 1) * rowHeight,
+                                          (float) liveArea.getWidth(), rowHeight));
+        }
+        
+        const int dominant = liveChroma.getDominantPitchClass();
+        
+        if (dominant >= 0)
+        {
+            g.setColour (Colours::white);
+            g.drawText (Chroma::getPitchClassName (dominant), area.reduced (4, 0), Justification::bottomLeft);
+        }
+    }
+    
+    void openButtonClicked()
+    {
+        initialiseSubsystems();
+        
+        FileChooser chooser ("Select a Wave file to play...",
+                             File::nonexistent,
+                             "*.wav;*.mp3;*.flac");
+        
+        if (chooser.browseForFileToOpen())
+            loadFile (chooser.getResult());
+    }
+    
+    // The file is opened in the background. Whatever is loaded now keeps
+    // playing until it's ready, and choosing another file first cancels it.
+    void loadFile (const File& file)
+    {
+        fileOpener.open (file);
+        frameScheduler.wake();
+        repaint (getThumbnailBounds());
+    }
+    
+    void fileOpened()
+    {
+        File file;
+        ScopedPointer<AudioFormatReader> reader;
+        
+        if (! fileOpener.takeOpenedFile (file, reader))
+            return;
+        
+        repaint (getThumbnailBounds());
+        
+        if (reader == nullptr)
+            Logger::writeToLog ("Couldn't open " + file.getFullPathName());
+        else
+            useFile (file, reader.release());
+    }
+    
+    // Swaps everything over to a file whose reader has already been opened
+    // through the block cache, so that the other readers created here find
+    // its decoder already open.
+    void useFile (const File& file, AudioFormatReader* openedReader)
+    {
+        ScopedPointer<AudioFormatReader> reader (openedReader);
+        
+        if (reader == nullptr)
+            return;
+        
+        if (playbackSlot.hasSource())
+            Logger::writeToLog (blockCache.getStatisticsDescription());
+        
+        // Playback, the thumbnail, looping and scrubbing all read through
+        // the same cache, so the file is only decoded once.
+        const double fileSampleRate = reader->sampleRate;
+        bool crossfaded;
+        
+        markers.loadCuePoints (reader->metadataValues, fileSampleRate);
+        
+        if (PreloadedClipCache::Clip::Ptr clip = clipCache.getClip (file))
+        {
+            crossfaded = setPlaybackSource (new ClipAudioSource (clip), fileSampleRate, false);
+        }
+        else
+        {
+            // Streamed this time; short files are decoded into memory in the
+            // background so that auditioning them again doesn't touch the disk.
+            crossfaded = setPlaybackSource (new AudioFormatReaderSource (reader.release(), true), fileSampleRate, true);
+            clipCache.preload (file);
+        }
+        
+        currentFile = file;
+        loopSource.setFile (file, ! crossfaded);
+        scrubSource.setFile (file);
+        positionOverlay.setLoopRange (Range<double>());
+        
+        if (! crossfaded)
+            timeStretch.flush();
+        
+        playButton.setEnabled (true);
+        thumbnail.setReader (blockCache.createReaderFor (file), file.hashCode64()); // [7]
+        chromagram = chromagramCache.getChromagramFor (file, file.hashCode64());
+        silenceIndex = silenceCache.getIndexFor (file, file.hashCode64());
+        silenceSkipper.setIndex (silenceIndex);
+        silenceShownOnOverview = false;
+        frameScheduler.wake();
+    }
+    
+    // Returns true if the new source was crossfaded in without stopping.
+    bool setPlaybackSource (PositionableAudioSource* newSource, double fileSampleRate, bool readFromDisk)
+    {
+        ScopedPointer<PositionableAudioSource> source (newSource);
+        isPlayingFromMemory = ! readFromDisk;
+        
+        if (canCrossfadeTo (*source, fileSampleRate, readFromDisk))
+        {
+            playbackSlot.swapTo (source.release());
+            return true;
+        }
+        
+        // Reading ahead on a background thread keeps disk access off the
+        // audio thread, including when a loop wraps around. Clips that are
+        // already in memory don't need it.
+        const int readAheadSize = readFromDisk && useReadAheadThread ? 32768 : 0;
+        
+        transportSource.setSource (nullptr);
+        playbackSlot.setSource (source.release());
+        transportSource.setSource (&playbackSlot, readAheadSize, &readAheadThread, fileSampleRate);
+        
+        transportSampleRate = fileSampleRate;
+        transportReadsAhead = readAheadSize > 0;
+        return false;
+    }
+    
+    // A file opened while playing is crossfaded in at the same position, as
+    // long as the transport is already set up the way the new file needs it.
+    // Otherwise the transport is stopped and given the file the usual way.
+    bool canCrossfadeTo (PositionableAudioSource& source, double fileSampleRate, bool readFromDisk) const
+    {
+        return state == Playing
+                && playbackSlot.hasSource()
+                && fileSampleRate == transportSampleRate
+                && (transportReadsAhead || ! readFromDisk || ! useReadAheadThread)
+                && playbackSlot.getNextReadPosition() < source.getTotalLength();
+    }
+    
+    // If the clip that has just been preloaded is the one that's loaded and
+    // it isn't playing, switch over to the in-memory copy straight away.
+    void clipPreloaded()
+    {
+        if (isPlayingFromMemory || state != Stopped)
+            return;
+        
+        if (PreloadedClipCache::Clip::Ptr clip = clipCache.getClip (currentFile))
+        {
+            setPlaybackSource (new ClipAudioSource (clip), clip->sampleRate, false);
+            loopSource.setPosition (0.0);
+            timeStretch.flush();
+        }
+    }
+    
+    void settingsButtonClicked()
+    {
+        initialiseSubsystems();
+        
+        if (settingsWindow != nullptr)
+        {
+            settingsWindow->toFront (true);
+            return;
+        }
+        
+        AudioSettingsPanel* panel = new AudioSettingsPanel (deviceManager, latencyMonitor, playheadClock,
+                                                            processingChain, frameScheduler);
+        panel->addSection (new CrossfadeSettingsSection (playbackSlot));
+        panel->addSection (new TraceSettingsSection());
+
+        DialogWindow::LaunchOptions options;
+        options.content.setOwned (panel);
+        options.dialogTitle = "Audio Settings";
+        options.componentToCentreAround = this;
+        options.useNativeTitleBar = true;
+        options.resizable = false;
+        
+        settingsWindow = options.launchAsync();
+    }
+    
+    void eqButtonClicked()
+    {
+        if (eqWindow != nullptr)
+        {
+            eqWindow->toFront (true);
+            return;
+        }
+        
+        DialogWindow::LaunchOptions options;
+        options.content.setOwned (new ParametricEqPanel (*eqProcessor, processingChain, eqNodeIndex));
+        options.dialogTitle = "EQ";
+        options.componentToCentreAround = this;
+        options.useNativeTitleBar = true;
+        options.resizable = false;
+        
+        eqWindow = options.launchAsync();
+    }
+    
+    void recordButtonClicked()
+    {
+        initialiseSubsystems();
+        
+        if (recorder.isRecording())
+            stopRecording();
+        else
+            startRecording();
+    }
+    
+    // Exports the loop selection on the overview. The exporter runs on its own
+    // thread with a progress window and deletes itself when it's done.
+    void exportButtonClicked()
+    {
+        const Range<double> region (positionOverlay.getLoopRange());
+        
+        if (! currentFile.existsAsFile() || region.isEmpty())
+        {
+            AlertWindow::showMessageBoxAsync (AlertWindow::InfoIcon, "Export region",
+                                              "Drag across the overview to select the region to export.");
+            return;
+        }
+        
+        const File folder (File::getSpecialLocation (File::userDocumentsDirectory)
+                               .getChildFile (ProjectInfo::projectName));
+        folder.createDirectory();
+        
+        FileChooser chooser ("Export the selected region as...",
+                             folder.getNonexistentChildFile (currentFile.getFileNameWithoutExtension() + " region",
+                                                             currentFile.hasFileExtension ("flac") ? ".flac" : ".wav"),
+                             "*.wav;*.flac");
+        
+        if (! chooser.browseForFileToSave (true))
+            return;
+        
+        if (chooser.getResult() == currentFile)
+        {
+            AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Export region",
+                                              "The region can't be exported over the file it comes from.");
+            return;
+        }
+        
+        (new RegionExporter (formatManager, currentFile, chooser.getResult(), region))->launchThread();
+    }
+    
+    void startRecording()
+    {
+        // The device normally runs playback-only, so the inputs are only opened
+        // for as long as something is being recorded.
+        setInputChannelsEnabled (true);
+        
+        AudioIODevice* device = deviceManager.getCurrentAudioDevice();
+        
+        if (device == nullptr || device->getActiveInputChannels().isZero())
+        {
+            setInputChannelsEnabled (false);
+            return;
+        }
+        
+        const File file (File::getSpecialLocation (File::userDocumentsDirectory)
+                             .getChildFile (ProjectInfo::projectName)
+                             .getNonexistentChildFile ("Recording", ".wav"));
+        file.getParentDirectory().createDirectory();
+        
+        if (recorder.startRecording (file, device->getCurrentSampleRate(),
+                                     device->getActiveInputChannels().countNumberOfSetBits()))
+        {
+            recordButton.setButtonText ("Stop recording");
+            liveWaveform.start();
+            liveWaveform.setVisible (true);
+            frameScheduler.wake();
+        }
+        else
+        {
+            setInputChannelsEnabled (false);
+        }
+    }
+    
+    void stopRecording()
+    {
+        recorder.stop();
+        liveWaveform.stop();
+        liveWaveform.setVisible (false);
+        setInputChannelsEnabled (false);
+        recordButton.setButtonText ("Record");
+        
+        Logger::writeToLog ("Recorded " + String (recorder.getNumSamplesRecorded()) + " samples to "
+                              + recorder.getRecordingFile().getFullPathName() + ", "
+                              + String (recorder.getNumBlocksDropped()) + " blocks dropped");
+    }
+    
+    void setInputChannelsEnabled (bool shouldBeEnabled)
+    {
+        AudioDeviceManager::AudioDeviceSetup setup;
+        deviceManager.getAudioDeviceSetup (setup);
+        
+        if (shouldBeEnabled == ! setup.inputChannels.isZero())
+            return;
+        
+        setup.inputChannels.clear();
+        
+        if (shouldBeEnabled)
+            setup.inputChannels.setRange (0, 2, true);
+        
+        setup.useDefaultInputChannels = false;
+        deviceManager.setAudioDeviceSetup (setup, true);
+    }
+    
+    void playButtonClicked()
+    {
+        if (state == Playing)
+            changeState (Pausing);
+        else if (state == Stopped || state == Paused)
+            changeState (Starting);
+    }
+    
+    void stopButtonClicked()
+    {
+        if (state == Paused)
+            changeState (Stopped);
+        else
+            changeState (Stopping);
+    }
+    
+    //==========================================================================
+    TextButton openButton;
+    TextButton settingsButton;
+    TextButton recordButton;
+    TextButton exportButton;
+    TextButton eqButton;
+    ToggleButton skipSilenceButton;
+    TextButton playButton;
+    TextButton stopButton;
+    
+    Label volumeLabel;
+    Slider levelSlider;
+    Label speedLabel;
+    Slider speedSlider;
+    AudioFormatManager formatManager;                    // [3]
+    DecodedBlockCache blockCache { formatManager };
+    PreloadedClipCache clipCache { blockCache };
+    FileOpener fileOpener { blockCache };
+    HotSwapAudioSource playbackSlot;
+    double transportSampleRate = 0.0;
+    bool transportReadsAhead = false;
+    File currentFile;
+    bool isPlayingFromMemory = false;
+    bool useReadAheadThread = true;
+    TimeSliceThread readAheadThread { "Audio file read-ahead" };
+    AudioTransportSource transportSource;
+    LoopingAudioSource loopSource { transportSource, blockCache, readAheadThread };
+    SilenceSkippingAudioSource silenceSkipper { loopSource, transportSource };
+    TimeStretchAudioSource timeStretch { &silenceSkipper, false };
+    ScrubAudioSource scrubSource { blockCache, readAheadThread };
+    TransportCommandQueue transportCommands;
+    ProcessingChain processingChain;
+    ParametricEqProcessor* eqProcessor = nullptr;   // owned by processingChain
+    GainProcessor* gainProcessor = nullptr;         // owned by processingChain
+    TransportState state;
+    AudioThumbnailCache thumbnailCache;                  // [1]
+    AudioThumbnail thumbnail;                            // [2]
+    WaveformRasterizer waveformRasterizer, overviewRasterizer;
+    ChromagramCache chromagramCache { blockCache, 5 };
+    Chromagram::Ptr chromagram;
+    SilenceIndexCache silenceCache { blockCache, 5 };
+    SilenceIndex::Ptr silenceIndex;
+    bool silenceShownOnOverview = false;
+    MarkerList markers;
+    LiveChromaAnalyser liveChroma;
+    PositionOverlay positionOverlay;
+    Goniometer goniometer;
+    LiveWaveform liveWaveform;
+    FrameScheduler frameScheduler { *this, 60 };
+    bool firstFramePainted = false;
+    bool subsystemsInitialised = false;
+    
+    LatencyMonitor latencyMonitor;
+    PlayheadClock playheadClock;
+    AudioRecorder recorder;
+    Component::SafePointer<DialogWindow> settingsWindow, eqWindow;
+    
+    LookAndFeel_V3 lookAndFeel;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainContentComponent)
+};
+
+#endif  // MAINCOMPONENT_H_INCLUDED
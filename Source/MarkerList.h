@@ -0,0 +1,240 @@
+#ifndef MARKERLIST_H_INCLUDED
+#define MARKERLIST_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    The markers in the current file: cue points read from the file, plus any
+    that the user adds.
+
+    Markers are kept sorted by time, so finding the next or previous marker
+    from a position, or the first one in a visible range, is a binary search.
+    When they're drawn, at most one marker is drawn per pixel. After drawing
+    one, the search jumps straight to the next pixel's worth of time. Drawing
+    therefore costs about the same whether a file has ten markers or tens of
+    thousands.
+
+    Cue points come from the reader's metadataValues. The WAV reader puts the
+    'cue ' chunk and the labels from its LIST 'adtl' chunk there. Other formats
+    leave them out, so those files just start with no markers.
+*/
+class MarkerList
+{
+public:
+    struct Marker
+    {
+        double time;
+        String name;
+        bool isUserMarker;
+    };
+
+    MarkerList() {}
+
+    //==============================================================================
+    /** Replaces the markers with the cue points in a reader's metadata. */
+    void loadCuePoints (const StringPairArray& metadata, double sampleRate)
+    {
+        markers.clearQuick();
+        numUserMarkers = 0;
+
+        if (sampleRate <= 0.0)
+            return;
+
+        // Looking keys up one at a time is a linear search each, which is far
+        // too slow with thousands of cues, so every key is visited just once.
+        Array<int64> cueIds, cueOffsets;
+        HashMap<int64, String> labels;
+        Array<int64> labelIds;
+        StringArray labelTexts;
+
+        const StringArray& keys = metadata.getAllKeys();
+        const StringArray& values = metadata.getAllValues();
+
+        for (int i = 0; i < keys.size(); ++i)
+        {
+            const String& key = keys[i];
+
+            if (key.startsWith ("CueLabel"))
+            {
+                const String rest (key.substring (8));
+                const int index = rest.getIntValue();
+                const String field (rest.trimCharactersAtStart ("0123456789"));
+
+                if (field == "Identifier")  setAtIndex (labelIds, index, values[i].getLargeIntValue());
+                else if (field == "Text")   setAtIndex (labelTexts, index, values[i]);
+            }
+            else if (key.startsWith ("Cue") && CharacterFunctions::isDigit (key[3]))
+            {
+                const String rest (key.substring (3));
+                const int index = rest.getIntValue();
+                const String field (rest.trimCharactersAtStart ("0123456789"));
+
+                if (field == "Identifier")  setAtIndex (cueIds, index, values[i].getLargeIntValue());
+                else if (field == "Offset") setAtIndex (cueOffsets, index, values[i].getLargeIntValue());
+            }
+        }
+
+        for (int i = 0; i < jmin (labelIds.size(), labelTexts.size()); ++i)
+            labels.set (labelIds.getUnchecked (i), labelTexts[i]);
+
+        const int numCues = jmin (cueIds.size(), cueOffsets.size());
+        markers.ensureStorageAllocated (numCues);
+
+        for (int i = 0; i < numCues; ++i)
+        {
+            const String label (labels[cueIds.getUnchecked (i)]);
+            const Marker marker = { cueOffsets.getUnchecked (i) / sampleRate,
+                                    label.isNotEmpty() ? label : "Cue " + String (i + 1),
+                                    false };
+            markers.add (marker);
+        }
+
+        MarkerComparator comparator;
+        markers.sort (comparator, true);
+    }
+
+    /** Adds a marker, keeping the list in order. Returns its index. */
+    int add (double time, const String& name, bool isUserMarker)
+    {
+        const Marker marker = { time, name, isUserMarker };
+        const int index = getFirstIndexAfter (time);
+        markers.insert (index, marker);
+
+        if (isUserMarker)
+            ++numUserMarkers;
+
+        return index;
+    }
+
+    /** Adds a user marker, named in the order they were added. */
+    int addUserMarker (double time)
+    {
+        return add (time, "Marker " + String (numUserMarkers + 1), true);
+    }
+
+    //==============================================================================
+    int size() const noexcept                       { return markers.size(); }
+    const Marker& getMarker (int index) const       { return markers.getReference (index); }
+
+    /** Returns the index of the first marker at or after the time. */
+    int getFirstIndexAtOrAfter (double time) const noexcept
+    {
+        int low = 0, high = markers.size();
+
+        while (low < high)
+        {
+            const int mid = (low + high) / 2;
+
+            if (markers.getReference (mid).time < time)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+
+        return low;
+    }
+
+    /** Returns the index of the first marker strictly after the time. */
+    int getFirstIndexAfter (double time) const noexcept
+    {
+        int low = 0, high = markers.size();
+
+        while (low < high)
+        {
+            const int mid = (low + high) / 2;
+
+            if (markers.getReference (mid).time <= time)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+
+        return low;
+    }
+
+    /** Returns the time of the first marker after the given time, or -1 if
+        there isn't one. */
+    double getNextTime (double time) const noexcept
+    {
+        const int index = getFirstIndexAfter (time);
+        return index < markers.size() ? markers.getReference (index).time : -1.0;
+    }
+
+    /** Returns the time of the last marker before the given time, or -1 if
+        there isn't one. */
+    double getPreviousTime (double time) const noexcept
+    {
+        const int index = getFirstIndexAtOrAfter (time) - 1;
+        return index >= 0 ? markers.getReference (index).time : -1.0;
+    }
+
+    //==============================================================================
+    /** Draws the markers between two times as vertical lines, optionally with
+        their names where there's room. */
+    void draw (Graphics& g, const Rectangle<int>& area, double startTime, double endTime, bool withNames) const
+    {
+        if (area.isEmpty() || endTime <= startTime)
+            return;
+
+        const double secondsPerPixel = (endTime - startTime) / area.getWidth();
+        const float top = (float) area.getY(), bottom = (float) area.getBottom();
+        int nameLimit = area.getX();
+
+        g.setFont (12.0f);
+
+        for (int i = getFirstIndexAtOrAfter (startTime); i < markers.size();)
+        {
+            const Marker& marker = markers.getReference (i);
+
+            if (marker.time >= endTime)
+                break;
+
+            const int pixel = (int) ((marker.time - startTime) / secondsPerPixel);
+            const int x = area.getX() + pixel;
+
+            g.setColour (marker.isUserMarker ? Colours::deepskyblue : Colours::gold);
+            g.drawVerticalLine (x, top, bottom);
+
+            if (withNames && x >= nameLimit)
+            {
+                g.drawText (marker.name, x + 2, area.getY(), nameWidth, 14, Justification::centredLeft, true);
+                nameLimit = x + nameWidth + 4;
+            }
+
+            // anything else in this pixel would be drawn on top of this one
+            i = jmax (i + 1, getFirstIndexAtOrAfter (startTime + (pixel + 1) * secondsPerPixel));
+        }
+    }
+
+private:
+    //==============================================================================
+    enum { nameWidth = 80 };
+
+    struct MarkerComparator
+    {
+        static int compareElements (const Marker& a, const Marker& b) noexcept
+        {
+            return a.time < b.time ? -1 : (b.time < a.time ? 1 : 0);
+        }
+    };
+
+    template <typename ArrayType, typename ValueType>
+    static void setAtIndex (ArrayType& array, int index, const ValueType& value)
+    {
+        if (! isPositiveAndBelow (index, 1 << 24))
+            return;
+
+        while (array.size() <= index)
+            array.add (ValueType());
+
+        array.set (index, value);
+    }
+
+    Array<Marker> markers;
+    int numUserMarkers = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MarkerList)
+};
+
+#endif  // MARKERLIST_H_INCLUDED
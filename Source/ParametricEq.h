@@ -0,0 +1,783 @@
+#ifndef PARAMETRICEQ_H_INCLUDED
+#define PARAMETRICEQ_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ProcessingChain.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#endif
+
+//==============================================================================
+/*
+    An eight-band parametric EQ for stereo playback.
+
+    The enabled bands of both channels run as one cascade of 4-lane SSE
+    biquads. The bands are split into two halves: lanes 0 and 1 run the first
+    half on the left and right input, while lanes 2 and 3 run the second half
+    on what the first half produced one sample earlier. Eight bands on two
+    channels is then four vector biquads per sample with every lane busy. The
+    one-sample skew is taken up at the block edges, so the output is the same
+    as running the cascade in series and there's no added latency.
+
+    Filter state is kept per band and per channel, in structure-of-arrays form,
+    and gathered into the lanes for each chunk. Bands can therefore come and go
+    without disturbing the others. The lanes live in a block of their own that's
+    aligned for SSE, since operator new only promises that for ordinary types.
+    Denormals are flushed to zero while the cascade runs, so a decaying tail
+    doesn't slow it down.
+
+    runEquivalenceTest() checks the SSE cascade against the same bands run one
+    after the other in plain C++; the tests build runs it with --eq.
+
+    Band settings are written from the GUI into atomics. The audio thread picks
+    them up between 64-sample chunks and glides frequency, gain and Q towards
+    them, recalculating the coefficients as it goes. A disabled peak or shelf
+    fades its gain to 0 dB before it's taken out of the cascade. A low-pass or
+    high-pass band has no gain to fade, so it's crossfaded with the dry signal
+    over 10 ms instead, going out and coming in. A band changing type fades out
+    the same way and comes back in with the new type. The crossfade is built
+    into the coefficients (see calculateCoefficients()), so it costs nothing
+    in the cascade. Each band keeps its last two inputs and outputs from the
+    end of a chunk, so that when its coefficients change, the filter state
+    can be carried over the way a direct form I filter would do it, without
+    a click.
+*/
+class ParametricEqProcessor : public ChainProcessor
+{
+public:
+    enum BandType
+    {
+        peak,
+        lowShelf,
+        highShelf,
+        lowPass,
+        highPass
+    };
+
+    enum { maxBands = 8 };
+
+    ParametricEqProcessor()
+    {
+       #if JUCE_INTEL
+        stageMemory.calloc (sizeof (Stage) * (maxBands / 2) + 15);
+        stages = reinterpret_cast<Stage*> ((reinterpret_cast<pointer_sized_int> (stageMemory.getData()) + 15)
+                                             & ~(pointer_sized_int) 15);
+       #endif
+
+        // a low shelf, six peaks and a high shelf, spread over the audio range
+        for (int i = 0; i < maxBands; ++i)
+        {
+            const BandType type = i == 0 ? lowShelf : (i == maxBands - 1 ? highShelf : peak);
+            setBand (i, type, 40.0f * std::pow (2.0f, i * 1.2f), 0.0f, 0.71f, false);
+        }
+    }
+
+    //==============================================================================
+    /** Can be called from any thread. Changes are glided or crossfaded in, and
+        a band that's switched off fades out before it stops being processed. */
+    void setBand (int index, BandType type, float frequency, float gainDecibels, float q, bool enabled)
+    {
+        jassert (isPositiveAndBelow (index, (int) maxBands));
+
+        BandTarget& target = targets[index];
+        target.type.set ((int) type);
+        target.frequency.set (frequency);
+        target.gain.set (gainDecibels);
+        target.q.set (jmax (0.05f, q));
+        target.enabled.set (enabled ? 1 : 0);
+
+        ++targetsVersion;
+    }
+
+    BandType getBandType (int index) const noexcept     { return (BandType) targets[index].type.get(); }
+    float getBandFrequency (int index) const noexcept   { return targets[index].frequency.get(); }
+    float getBandGain (int index) const noexcept        { return targets[index].gain.get(); }
+    float getBandQ (int index) const noexcept           { return targets[index].q.get(); }
+    bool isBandEnabled (int index) const noexcept       { return targets[index].enabled.get() != 0; }
+
+    //==============================================================================
+    const String getName() const override       { return "Parametric EQ"; }
+
+    void prepareToPlay (double newSampleRate, int) override
+    {
+        sampleRate = newSampleRate;
+        seenVersion = targetsVersion.get();
+
+        for (int i = 0; i < maxBands; ++i)
+        {
+            Band& band = bands[i];
+            band.type = (BandType) targets[i].type.get();
+            readTarget (i, band);
+
+            band.logFrequency = band.targetLogFrequency;
+            band.gain = band.targetGain;
+            band.q = band.targetQ;
+            band.mix = band.targetMix = 1.0f;
+            band.active = band.enabled;
+
+            zeromem (band.state, sizeof (band.state));
+            zeromem (band.history, sizeof (band.history));
+            calculateCoefficients (band);
+        }
+    }
+
+    void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+    {
+        jassert (buffer.getNumChannels() <= 2);
+
+        if (buffer.getNumChannels() == 0)
+            return;
+
+        const ScopedNoDenormals noDenormals;
+
+        float* left  = buffer.getWritePointer (0);
+        float* right = buffer.getNumChannels() > 1 ? buffer.getWritePointer (1) : nullptr;
+
+        for (int done = 0; done < buffer.getNumSamples();)
+        {
+            const int num = jmin ((int) chunkSize, buffer.getNumSamples() - done);
+
+            updateBands (num);
+            processChunk (left + done, right != nullptr ? right + done : nullptr, num);
+
+            done += num;
+        }
+    }
+
+    //==============================================================================
+    /** Times the EQ on white noise at 48 kHz with 1 to 8 peak bands enabled, and
+        returns a line of results for each. */
+    static String runBenchmark()
+    {
+        const double rate = 48000.0;
+        const int blockSize = 512, numBlocks = 2000;
+
+        AudioSampleBuffer noise (2, blockSize);
+        Random random (1);
+
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                noise.setSample (ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+        AudioSampleBuffer block (2, blockSize);
+        MidiBuffer midi;
+        String results;
+
+        for (int numBands = 1; numBands <= maxBands; ++numBands)
+        {
+            ParametricEqProcessor eq;
+
+            for (int i = 0; i < numBands; ++i)
+                eq.setBand (i, peak, 100.0f * (i + 1), 3.0f, 1.0f, true);
+
+            eq.prepareToPlay (rate, blockSize);
+
+            double seconds = 0.0;
+
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                block.makeCopyOf (noise);
+
+                const int64 start = Time::getHighResolutionTicks();
+                eq.processBlock (block, midi);
+                seconds += Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+            }
+
+            const double numSamples = (double) numBlocks * blockSize;
+
+            results << "eq bands=" << numBands
+                    << " ns_per_band_per_channel_sample=" << String (seconds * 1.0e9 / (numSamples * numBands * 2), 3)
+                    << " cpu_percent_at_48k=" << String (100.0 * seconds / (numSamples / rate), 3)
+                    << newLine;
+        }
+
+        return results;
+    }
+
+    /** Runs noise through the EQ and through the same bands in series, with
+        1 to 8 bands on one and two channels, at block sizes that don't line up
+        with the chunks, while the bands glide, change type and switch off.
+        Returns a line for each, and sets passed if every output matched bit
+        for bit. */
+    static String runEquivalenceTest (bool& passed)
+    {
+        const double rate = 48000.0;
+        const int blockSizes[] = { 1, 3, 63, 64, 65, 200, 511 };
+        const int numBlocks = 400;
+
+        AudioSampleBuffer expected (2, 512);
+        MidiBuffer midi;
+        Random random (1);
+        String results;
+        passed = true;
+
+        // the reference has to flush denormals just as processBlock() does
+        const ScopedNoDenormals noDenormals;
+
+        for (int numBands = 1; numBands <= maxBands; ++numBands)
+        {
+            for (int numChannels = 1; numChannels <= 2; ++numChannels)
+            {
+                ParametricEqProcessor eq, reference;
+                int64 numMismatches = 0;
+                float maxDifference = 0.0f;
+
+                for (int i = 0; i < numBands; ++i)
+                {
+                    const BandType type = (BandType) (i % 5);
+                    eq.setBand (i, type, 60.0f * (i + 1), 6.0f - 2.0f * i, 0.5f + 0.3f * i, true);
+                    reference.setBand (i, type, 60.0f * (i + 1), 6.0f - 2.0f * i, 0.5f + 0.3f * i, true);
+                }
+
+                eq.prepareToPlay (rate, 512);
+                reference.prepareToPlay (rate, 512);
+
+                for (int n = 0; n < numBlocks; ++n)
+                {
+                    const int numSamples = blockSizes[n % numElementsInArray (blockSizes)];
+
+                    // move every band and change its type halfway through, and switch
+                    // every other one off near the end
+                    if (n == numBlocks / 2 || n == numBlocks * 3 / 4)
+                    {
+                        for (int i = 0; i < numBands; ++i)
+                        {
+                            const BandType type = (BandType) ((i + 1) % 5);
+                            const bool enabled = n == numBlocks / 2 || i % 2 != 0;
+                            eq.setBand (i, type, 2000.0f / (i + 1), 2.0f * i - 6.0f, 2.0f, enabled);
+                            reference.setBand (i, type, 2000.0f / (i + 1), 2.0f * i - 6.0f, 2.0f, enabled);
+                        }
+                    }
+
+                    AudioSampleBuffer input (numChannels, numSamples);
+
+                    for (int ch = 0; ch < numChannels; ++ch)
+                    {
+                        for (int i = 0; i < numSamples; ++i)
+                            input.setSample (ch, i, random.nextFloat() - 0.5f);
+
+                        expected.copyFrom (ch, 0, input, ch, 0, numSamples);
+                    }
+
+                    eq.processBlock (input, midi);
+
+                    float* left  = expected.getWritePointer (0);
+                    float* right = numChannels > 1 ? expected.getWritePointer (1) : nullptr;
+
+                    for (int done = 0; done < numSamples;)
+                    {
+                        const int num = jmin ((int) chunkSize, numSamples - done);
+
+                        reference.updateBands (num);
+                        reference.processSerial (left + done, right != nullptr ? right + done : nullptr, num);
+
+                        done += num;
+                    }
+
+                    for (int ch = 0; ch < numChannels; ++ch)
+                    {
+                        for (int i = 0; i < numSamples; ++i)
+                        {
+                            const float difference = std::abs (input.getSample (ch, i) - expected.getSample (ch, i));
+
+                            if (input.getSample (ch, i) != expected.getSample (ch, i))
+                                ++numMismatches;
+
+                            maxDifference = jmax (maxDifference, difference);
+                        }
+                    }
+                }
+
+                passed = passed && numMismatches == 0;
+
+                results << "eq bands=" << numBands
+                        << " channels=" << numChannels
+                        << " mismatched_samples=" << numMismatches
+                        << " max_difference=" << String (maxDifference, 9)
+                        << newLine;
+            }
+        }
+
+        results << (passed ? "PASSED" : "FAILED") << newLine;
+        return results;
+    }
+
+private:
+    //==============================================================================
+    enum
+    {
+        chunkSize = 64,
+        crossfadeMs = 10    // for bands without a gain to fade, and type changes
+    };
+
+    struct BandTarget
+    {
+        Atomic<int> type, enabled;
+        Atomic<float> frequency, gain, q;
+    };
+
+    // only touched by the audio thread
+    struct Band
+    {
+        BandType type = peak, targetType = peak;
+        bool enabled = false, active = false;
+        float logFrequency = 0.0f, gain = 0.0f, q = 0.71f;
+        float targetLogFrequency = 0.0f, targetGain = 0.0f, targetQ = 0.71f;
+        float mix = 1.0f, targetMix = 1.0f;     // 0 is the dry signal
+
+        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+        float state[2][2];      // [channel][s1, s2]
+        float history[2][4];    // [channel][x[n], x[n-1], y[n], y[n-1]] at the end of the last chunk
+
+        bool isGliding() const noexcept
+        {
+            return logFrequency != targetLogFrequency || gain != targetGain || q != targetQ
+                    || mix != targetMix;
+        }
+    };
+
+    static bool hasGain (BandType type) noexcept
+    {
+        return type == peak || type == lowShelf || type == highShelf;
+    }
+
+    // Four lanes of one biquad stage: left and right of a band from the first
+    // half of the cascade, then left and right of a band from the second half.
+    // Each array is loaded as a vector, so a Stage must start on 16 bytes.
+    struct Stage
+    {
+        float b0[4], b1[4], b2[4], a1[4], a2[4];
+        float s1[4], s2[4];
+        float x1[4], x2[4], y1[4], y2[4];
+    };
+
+    void readTarget (int index, Band& band) const noexcept
+    {
+        const BandTarget& target = targets[index];
+
+        band.targetType = (BandType) target.type.get();
+        band.enabled = target.enabled.get() != 0;
+        band.targetLogFrequency = std::log (jlimit (10.0f, (float) (sampleRate * 0.49), target.frequency.get()));
+        band.targetQ = target.q.get();
+
+        // A band being switched off glides back to flat before it's dropped, or
+        // if it has no gain, back to the dry signal. A band changing type goes
+        // to the dry signal too, before the new type comes in.
+        band.targetGain = band.enabled || ! hasGain (band.type) ? target.gain.get() : 0.0f;
+        band.targetMix = band.type == band.targetType && (band.enabled || hasGain (band.type)) ? 1.0f : 0.0f;
+    }
+
+    void updateBands (int numSamples) noexcept
+    {
+        const int version = targetsVersion.get();
+
+        if (version != seenVersion)
+        {
+            seenVersion = version;
+
+            for (int i = 0; i < maxBands; ++i)
+            {
+                Band& band = bands[i];
+                const bool wasActive = band.active;
+                readTarget (i, band);
+
+                if (band.enabled && ! wasActive)
+                {
+                    // A band coming in starts flat, from silence in its filter state:
+                    // at 0 dB if it has a gain, otherwise as the dry signal.
+                    band.type = band.targetType;
+                    readTarget (i, band);
+
+                    band.active = true;
+                    band.logFrequency = band.targetLogFrequency;
+                    band.q = band.targetQ;
+                    band.gain = hasGain (band.type) ? 0.0f : band.targetGain;
+                    band.mix = hasGain (band.type) ? 1.0f : 0.0f;
+                    zeromem (band.state, sizeof (band.state));
+                    zeromem (band.history, sizeof (band.history));
+                    calculateCoefficients (band);
+                }
+            }
+        }
+
+        // glide with a time constant of about 30 ms, and crossfade in straight lines
+        const float amount = (float) (1.0 - std::exp (-numSamples / (0.03 * sampleRate)));
+        const float mixStep = (float) (numSamples * 1000.0 / (crossfadeMs * sampleRate));
+
+        for (int i = 0; i < maxBands; ++i)
+        {
+            Band& band = bands[i];
+
+            if (! band.active)
+                continue;
+
+            if (band.type != band.targetType && band.mix == 0.0f)
+            {
+                // faded out, so the new type can take over at its target settings
+                band.type = band.targetType;
+                readTarget (i, band);
+
+                band.logFrequency = band.targetLogFrequency;
+                band.gain = band.targetGain;
+                band.q = band.targetQ;
+                calculateCoefficients (band);
+            }
+
+            if (band.isGliding())
+            {
+                band.logFrequency = glide (band.logFrequency, band.targetLogFrequency, amount, 0.001f);
+                band.gain         = glide (band.gain,         band.targetGain,         amount, 0.01f);
+                band.q            = glide (band.q,            band.targetQ,            amount, 0.001f);
+                band.mix          = std::abs (band.targetMix - band.mix) <= mixStep ? band.targetMix
+                                      : band.mix + (band.targetMix > band.mix ? mixStep : -mixStep);
+                calculateCoefficients (band);
+            }
+
+            if (! band.enabled && ! band.isGliding())
+                band.active = false;
+        }
+    }
+
+    static float glide (float current, float target, float amount, float snapDistance) noexcept
+    {
+        current += (target - current) * amount;
+        return std::abs (target - current) < snapDistance ? target : current;
+    }
+
+    // RBJ cookbook biquads, normalised so that a0 = 1.
+    void calculateCoefficients (Band& band) const noexcept
+    {
+        const double w0 = 2.0 * double_Pi * std::exp ((double) band.logFrequency) / sampleRate;
+        const double cosW0 = std::cos (w0);
+        const double alpha = std::sin (w0) / (2.0 * band.q);
+        const double A = std::pow (10.0, band.gain / 40.0);
+        const double shelfAlpha = 2.0 * std::sqrt (A) * alpha;
+
+        double b0, b1, b2, a0, a1, a2;
+
+        switch (band.type)
+        {
+            case lowShelf:
+                b0 = A * ((A + 1) - (A - 1) * cosW0 + shelfAlpha);
+                b1 = 2 * A * ((A - 1) - (A + 1) * cosW0);
+                b2 = A * ((A + 1) - (A - 1) * cosW0 - shelfAlpha);
+                a0 = (A + 1) + (A - 1) * cosW0 + shelfAlpha;
+                a1 = -2 * ((A - 1) + (A + 1) * cosW0);
+                a2 = (A + 1) + (A - 1) * cosW0 - shelfAlpha;
+                break;
+
+            case highShelf:
+                b0 = A * ((A + 1) + (A - 1) * cosW0 + shelfAlpha);
+                b1 = -2 * A * ((A - 1) + (A + 1) * cosW0);
+                b2 = A * ((A + 1) + (A - 1) * cosW0 - shelfAlpha);
+                a0 = (A + 1) - (A - 1) * cosW0 + shelfAlpha;
+                a1 = 2 * ((A - 1) - (A + 1) * cosW0);
+                a2 = (A + 1) - (A - 1) * cosW0 - shelfAlpha;
+                break;
+
+            case lowPass:
+                b0 = (1 - cosW0) / 2;
+                b1 = 1 - cosW0;
+                b2 = (1 - cosW0) / 2;
+                a0 = 1 + alpha;
+                a1 = -2 * cosW0;
+                a2 = 1 - alpha;
+                break;
+
+            case highPass:
+                b0 = (1 + cosW0) / 2;
+                b1 = -(1 + cosW0);
+                b2 = (1 + cosW0) / 2;
+                a0 = 1 + alpha;
+                a1 = -2 * cosW0;
+                a2 = 1 - alpha;
+                break;
+
+            case peak:
+            default:
+                b0 = 1 + alpha * A;
+                b1 = -2 * cosW0;
+                b2 = 1 - alpha * A;
+                a0 = 1 + alpha / A;
+                a1 = -2 * cosW0;
+                a2 = 1 - alpha / A;
+                break;
+        }
+
+        // Mixing the output with the dry signal, which is the same filter with
+        // the denominator for its numerator, is a blend of the two numerators.
+        if (band.mix < 1.0f)
+        {
+            const double wet = band.mix, dry = 1.0 - band.mix;
+
+            b0 = wet * b0 + dry * a0;
+            b1 = wet * b1 + dry * a1;
+            b2 = wet * b2 + dry * a2;
+        }
+
+        const float newB1 = (float) (b1 / a0), newB2 = (float) (b2 / a0);
+        const float newA1 = (float) (a1 / a0), newA2 = (float) (a2 / a0);
+
+        // The state holds the last samples already multiplied by the old
+        // coefficients, so it's moved on to what the new ones would have made
+        // of them. The filter then carries on like a direct form I one, and a
+        // glide or crossfade doesn't click.
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            const float* h = band.history[ch];
+
+            band.state[ch][0] += (newB1 - band.b1) * h[0] + (newB2 - band.b2) * h[1]
+                                   - (newA1 - band.a1) * h[2] - (newA2 - band.a2) * h[3];
+            band.state[ch][1] += (newB2 - band.b2) * h[0] - (newA2 - band.a2) * h[2];
+        }
+
+        band.b0 = (float) (b0 / a0);
+        band.b1 = newB1;
+        band.b2 = newB2;
+        band.a1 = newA1;
+        band.a2 = newA2;
+    }
+
+    //==============================================================================
+    int getActiveBands (Band** active) noexcept
+    {
+        int numActive = 0;
+
+        for (int i = 0; i < maxBands; ++i)
+            if (bands[i].active)
+                active[numActive++] = bands + i;
+
+        return numActive;
+    }
+
+    void processChunk (float* left, float* right, int numSamples) noexcept
+    {
+       #if JUCE_INTEL
+        Band* active[maxBands];
+        const int numActive = getActiveBands (active);
+
+        if (numActive == 0)
+            return;
+
+        // the first half of the bands goes in lanes 0-1, the rest in lanes 2-3
+        const int numStages = (numActive + 1) / 2;
+
+        for (int s = 0; s < numStages; ++s)
+        {
+            loadLanes (stages[s], 0, active[s]);
+            loadLanes (stages[s], 2, s + numStages < numActive ? active[s + numStages] : nullptr);
+        }
+
+        processStages (left, right, numSamples, numStages);
+
+        for (int s = 0; s < numStages; ++s)
+        {
+            storeLanes (stages[s], 0, *active[s]);
+
+            if (s + numStages < numActive)
+                storeLanes (stages[s], 2, *active[s + numStages]);
+        }
+       #else
+        processSerial (left, right, numSamples);
+       #endif
+    }
+
+    // Runs the active bands one after the other on each channel. This is the
+    // cascade the SSE version has to match.
+    void processSerial (float* left, float* right, int numSamples) noexcept
+    {
+        Band* active[maxBands];
+        const int numActive = getActiveBands (active);
+
+        for (int ch = 0; ch < (right != nullptr ? 2 : 1); ++ch)
+        {
+            float* data = ch == 0 ? left : right;
+
+            for (int b = 0; b < numActive; ++b)
+            {
+                Band& band = *active[b];
+                float s1 = band.state[ch][0], s2 = band.state[ch][1];
+                float* history = band.history[ch];
+
+                history[1] = numSamples > 1 ? data[numSamples - 2] : history[0];
+                history[0] = data[numSamples - 1];
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const float x = data[i];
+                    const float y = band.b0 * x + s1;
+                    s1 = band.b1 * x - band.a1 * y + s2;
+                    s2 = band.b2 * x - band.a2 * y;
+                    data[i] = y;
+                }
+
+                band.state[ch][0] = s1;
+                band.state[ch][1] = s2;
+
+                history[3] = numSamples > 1 ? data[numSamples - 2] : history[2];
+                history[2] = data[numSamples - 1];
+            }
+        }
+    }
+
+   #if JUCE_INTEL
+    // A missing band is loaded as a pass-through.
+    static void loadLanes (Stage& stage, int firstLane, const Band* band) noexcept
+    {
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            const int lane = firstLane + ch;
+
+            stage.b0[lane] = band != nullptr ? band->b0 : 1.0f;
+            stage.b1[lane] = band != nullptr ? band->b1 : 0.0f;
+            stage.b2[lane] = band != nullptr ? band->b2 : 0.0f;
+            stage.a1[lane] = band != nullptr ? band->a1 : 0.0f;
+            stage.a2[lane] = band != nullptr ? band->a2 : 0.0f;
+            stage.s1[lane] = band != nullptr ? band->state[ch][0] : 0.0f;
+            stage.s2[lane] = band != nullptr ? band->state[ch][1] : 0.0f;
+            stage.x1[lane] = band != nullptr ? band->history[ch][0] : 0.0f;
+            stage.x2[lane] = band != nullptr ? band->history[ch][1] : 0.0f;
+            stage.y1[lane] = band != nullptr ? band->history[ch][2] : 0.0f;
+            stage.y2[lane] = band != nullptr ? band->history[ch][3] : 0.0f;
+        }
+    }
+
+    static void storeLanes (const Stage& stage, int firstLane, Band& band) noexcept
+    {
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            const int lane = firstLane + ch;
+
+            band.state[ch][0] = stage.s1[lane];
+            band.state[ch][1] = stage.s2[lane];
+            band.history[ch][0] = stage.x1[lane];
+            band.history[ch][1] = stage.x2[lane];
+            band.history[ch][2] = stage.y1[lane];
+            band.history[ch][3] = stage.y2[lane];
+        }
+    }
+
+    // Runs one sample through every stage, updating the state in all four lanes.
+    // Only the last two samples of a chunk need to be kept in the history.
+    template <bool keepHistory>
+    static forcedinline __m128 runStages (Stage* stages, int numStages, __m128 x) noexcept
+    {
+        for (int s = 0; s < numStages; ++s)
+        {
+            Stage& stage = stages[s];
+            const __m128 s1 = _mm_load_ps (stage.s1);
+            const __m128 s2 = _mm_load_ps (stage.s2);
+
+            const __m128 y = _mm_add_ps (_mm_mul_ps (_mm_load_ps (stage.b0), x), s1);
+
+            _mm_store_ps (stage.s1, _mm_add_ps (_mm_sub_ps (_mm_mul_ps (_mm_load_ps (stage.b1), x),
+                                                            _mm_mul_ps (_mm_load_ps (stage.a1), y)), s2));
+            _mm_store_ps (stage.s2, _mm_sub_ps (_mm_mul_ps (_mm_load_ps (stage.b2), x),
+                                                _mm_mul_ps (_mm_load_ps (stage.a2), y)));
+
+            if (keepHistory)
+            {
+                _mm_store_ps (stage.x2, _mm_load_ps (stage.x1));
+                _mm_store_ps (stage.x1, x);
+                _mm_store_ps (stage.y2, _mm_load_ps (stage.y1));
+                _mm_store_ps (stage.y1, y);
+            }
+
+            x = y;
+        }
+
+        return x;
+    }
+
+    // Runs one sample but only keeps the state changes in the lanes selected by mask.
+    static __m128 runStagesMasked (Stage* stages, int numStages, __m128 x, __m128 mask) noexcept
+    {
+        enum { numArrays = 6 };
+        __m128 old[maxBands / 2][numArrays];
+
+        for (int s = 0; s < numStages; ++s)
+            for (int i = 0; i < numArrays; ++i)
+                old[s][i] = _mm_load_ps (getStateArray (stages[s], i));
+
+        const __m128 y = runStages<true> (stages, numStages, x);
+
+        for (int s = 0; s < numStages; ++s)
+        {
+            for (int i = 0; i < numArrays; ++i)
+            {
+                float* array = getStateArray (stages[s], i);
+                _mm_store_ps (array, _mm_or_ps (_mm_and_ps (mask, _mm_load_ps (array)), _mm_andnot_ps (mask, old[s][i])));
+            }
+        }
+
+        return y;
+    }
+
+    static float* getStateArray (Stage& stage, int index) noexcept
+    {
+        float* const arrays[] = { stage.s1, stage.s2, stage.x1, stage.x2, stage.y1, stage.y2 };
+        return arrays[index];
+    }
+
+    template <bool keepHistory>
+    forcedinline __m128 runSample (float* left, float* right, int i, int numStages, __m128 y) noexcept
+    {
+        const __m128 input = _mm_setr_ps (left[i], right != nullptr ? right[i] : 0.0f, 0.0f, 0.0f);
+        y = runStages<keepHistory> (stages, numStages, _mm_movelh_ps (input, y));
+
+        _mm_store_ss (left + i - 1, _mm_movehl_ps (y, y));
+
+        if (right != nullptr)
+            _mm_store_ss (right + i - 1, _mm_shuffle_ps (y, y, _MM_SHUFFLE (3, 3, 3, 3)));
+
+        return y;
+    }
+
+    void processStages (float* left, float* right, int numSamples, int numStages) noexcept
+    {
+        const __m128 firstHalf  = _mm_castsi128_ps (_mm_setr_epi32 (-1, -1, 0, 0));
+        const __m128 secondHalf = _mm_castsi128_ps (_mm_setr_epi32 (0, 0, -1, -1));
+
+        // Sample 0 only goes through the first half, and the last sample only
+        // through the second half; in between, each vector holds sample n in
+        // lanes 0-1 and sample n - 1 in lanes 2-3.
+        __m128 y = runStagesMasked (stages, numStages,
+                                    _mm_setr_ps (left[0], right != nullptr ? right[0] : 0.0f, 0.0f, 0.0f),
+                                    firstHalf);
+
+        const int numWithoutHistory = jmax (1, numSamples - 2);
+
+        for (int i = 1; i < numWithoutHistory; ++i)
+            y = runSample<false> (left, right, i, numStages, y);
+
+        for (int i = numWithoutHistory; i < numSamples; ++i)
+            y = runSample<true> (left, right, i, numStages, y);
+
+        y = runStagesMasked (stages, numStages, _mm_movelh_ps (_mm_setzero_ps(), y), secondHalf);
+
+        _mm_store_ss (left + numSamples - 1, _mm_movehl_ps (y, y));
+
+        if (right != nullptr)
+            _mm_store_ss (right + numSamples - 1, _mm_shuffle_ps (y, y, _MM_SHUFFLE (3, 3, 3, 3)));
+    }
+   #endif
+
+    //==============================================================================
+    BandTarget targets[maxBands];
+    Atomic<int> targetsVersion;
+
+    // only touched by the audio thread
+    double sampleRate = 44100.0;
+    int seenVersion = -1;
+    Band bands[maxBands];
+
+   #if JUCE_INTEL
+    HeapBlock<char> stageMemory;
+    Stage* stages = nullptr;    // 16-byte aligned, inside stageMemory
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParametricEqProcessor)
+};
+
+#endif  // PARAMETRICEQ_H_INCLUDED
@@ -0,0 +1,139 @@
+#ifndef PARAMETRICEQPANEL_H_INCLUDED
+#define PARAMETRICEQPANEL_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ParametricEq.h"
+
+//==============================================================================
+/*
+    Controls for the ParametricEqProcessor: a row per band with an on/off
+    switch and frequency, gain and Q sliders.
+
+    The EQ's node in the processing chain is bypassed whenever no band is
+    switched on, so that it costs nothing until it's used. That happens a
+    little after the last band is switched off, once the band has faded out.
+*/
+class ParametricEqPanel : public Component,
+                          private ButtonListener,
+                          private Slider::Listener,
+                          private Timer
+{
+public:
+    ParametricEqPanel (ParametricEqProcessor& eqToControl, ProcessingChain& chainToUse, int eqIndexInChain)
+       : eq (eqToControl),
+         chain (chainToUse),
+         eqIndex (eqIndexInChain)
+    {
+        for (int i = 0; i < ParametricEqProcessor::maxBands; ++i)
+            rows.add (new BandRow (*this, i));
+
+        setSize (560, 30 * ParametricEqProcessor::maxBands + 20);
+    }
+
+    void resized() override
+    {
+        Rectangle<int> area (getLocalBounds().reduced (10));
+
+        for (int i = 0; i < rows.size(); ++i)
+        {
+            Rectangle<int> row (area.removeFromTop (30).reduced (0, 4));
+            BandRow& r = *rows.getUnchecked (i);
+
+            r.enableButton.setBounds (row.removeFromLeft (80));
+
+            const int sliderWidth = row.getWidth() / 3;
+            r.frequencySlider.setBounds (row.removeFromLeft (sliderWidth));
+            r.gainSlider.setBounds (row.removeFromLeft (sliderWidth));
+            r.qSlider.setBounds (row);
+        }
+    }
+
+private:
+    //==============================================================================
+    struct BandRow
+    {
+        BandRow (ParametricEqPanel& owner, int bandIndex)
+        {
+            const ParametricEqProcessor& eq = owner.eq;
+
+            static const char* const typeNames[] = { "Peak", "Low shelf", "High shelf", "Low pass", "High pass" };
+            enableButton.setButtonText (String (bandIndex + 1) + " " + typeNames[eq.getBandType (bandIndex)]);
+            enableButton.setToggleState (eq.isBandEnabled (bandIndex), dontSendNotification);
+            enableButton.addListener (&owner);
+            owner.addAndMakeVisible (enableButton);
+
+            setUpSlider (owner, frequencySlider, 20.0, 20000.0, eq.getBandFrequency (bandIndex), " Hz");
+            frequencySlider.setSkewFactorFromMidPoint (1000.0);
+
+            setUpSlider (owner, gainSlider, -18.0, 18.0, eq.getBandGain (bandIndex), " dB");
+            gainSlider.setDoubleClickReturnValue (true, 0.0);
+
+            setUpSlider (owner, qSlider, 0.1, 10.0, eq.getBandQ (bandIndex), " Q");
+            qSlider.setSkewFactorFromMidPoint (1.0);
+        }
+
+        static void setUpSlider (ParametricEqPanel& owner, Slider& slider,
+                                 double minimum, double maximum, double value, const String& suffix)
+        {
+            slider.setSliderStyle (Slider::LinearHorizontal);
+            slider.setTextBoxStyle (Slider::TextBoxRight, false, 70, 20);
+            slider.setRange (minimum, maximum, 0.01);
+            slider.setValue (value, dontSendNotification);
+            slider.setTextValueSuffix (suffix);
+            slider.addListener (&owner);
+            owner.addAndMakeVisible (slider);
+        }
+
+        ToggleButton enableButton;
+        Slider frequencySlider, gainSlider, qSlider;
+    };
+
+    void buttonClicked (Button*) override       { updateEq(); }
+    void sliderValueChanged (Slider*) override  { updateEq(); }
+
+    void updateEq()
+    {
+        bool anyEnabled = false;
+
+        for (int i = 0; i < rows.size(); ++i)
+        {
+            const BandRow& r = *rows.getUnchecked (i);
+            const bool enabled = r.enableButton.getToggleState();
+
+            eq.setBand (i, eq.getBandType (i),
+                        (float) r.frequencySlider.getValue(),
+                        (float) r.gainSlider.getValue(),
+                        (float) r.qSlider.getValue(),
+                        enabled);
+
+            anyEnabled = anyEnabled || enabled;
+        }
+
+        if (anyEnabled)
+        {
+            stopTimer();
+            chain.setBypassed (eqIndex, false);
+        }
+        else
+        {
+            startTimer (250);
+        }
+    }
+
+    void timerCallback() override
+    {
+        stopTimer();
+        chain.setBypassed (eqIndex, true);
+    }
+
+    //==============================================================================
+    ParametricEqProcessor& eq;
+    ProcessingChain& chain;
+    const int eqIndex;
+
+    OwnedArray<BandRow> rows;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParametricEqPanel)
+};
+
+#endif  // PARAMETRICEQPANEL_H_INCLUDED
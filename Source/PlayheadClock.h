@@ -0,0 +1,206 @@
+#ifndef PLAYHEADCLOCK_H_INCLUDED
+#define PLAYHEADCLOCK_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Lets the GUI draw the playhead where the audio actually is, at any moment.
+
+    At the top of each block the audio thread publishes the position of the
+    block's first sample, the rate at which the position is moving, and a
+    high-resolution timestamp. The three are written under a sequence counter,
+    so a reader never sees half of one snapshot and half of another.
+    getPosition() extrapolates from the latest snapshot to the current time,
+    less the output latency, so the playhead moves smoothly however often it's
+    drawn rather than jumping once per buffer.
+
+    Callbacks arrive late by varying amounts, but the device plays its samples
+    at a steady rate, so the samples published so far give a better clock. The
+    earliest any block has arrived, less the time its samples take, sets that
+    clock's origin. Once per drawn frame, measureFrame() compares the position
+    getPosition() gives against that clock's position for the same moment. The
+    difference is how far the drawn playhead is from what's being heard. It's
+    kept as a running mean and maximum in milliseconds.
+*/
+class PlayheadClock
+{
+public:
+    PlayheadClock() {}
+
+    /** Called when the device starts. The latency is the time, in samples, between
+        a block being rendered and its first sample leaving the speakers. */
+    void prepare (double newSampleRate, int outputLatencyInSamples)
+    {
+        sampleRate = newSampleRate;
+        latencySeconds.set (sampleRate > 0.0 ? outputLatencyInSamples / sampleRate : 0.0);
+        numSamplesPublished = 0;
+    }
+
+    /** Called on the audio thread at the start of each block. The rate is how many
+        seconds the position moves per second (0 when stopped). If the position is
+        inside the loop range, extrapolation wraps around it. */
+    void publish (double position, double rate, Range<double> loopRange, int numSamples) noexcept
+    {
+        publishAt (Time::getHighResolutionTicks(), position, rate, loopRange, numSamples);
+    }
+
+    /** The same as publish(), for a block that arrived at the given time. */
+    void publishAt (int64 now, double position, double rate, Range<double> loopRange, int numSamples) noexcept
+    {
+        if (! loopRange.contains (position))
+            loopRange = Range<double>();
+
+        // Small blocks are often late by more than their own length.
+        const int64 maxTicks = sampleRate > 0.0 ? Time::secondsToHighResolutionTicks (jmax (2.0 * numSamples / sampleRate, 0.02))
+                                                : 0;
+        const int64 origin = now - samplesToTicks (numSamplesPublished);
+
+        // A block can be late but never early. Rising slowly towards later
+        // blocks follows any drift between the device's clock and this one.
+        if (numSamplesPublished == 0 || origin < clockOrigin)
+            clockOrigin = origin;
+        else
+            clockOrigin += (origin - clockOrigin) / 1024;
+
+        sequence += 1;
+        snapshotPosition.set (position);
+        snapshotRate.set (rate);
+        snapshotTicks.set (now);
+        snapshotClockTicks.set (clockOrigin + samplesToTicks (numSamplesPublished));
+        snapshotMaxTicks.set (maxTicks);
+        snapshotLoopStart.set (loopRange.getStart());
+        snapshotLoopEnd.set (loopRange.getEnd());
+        sequence += 1;
+
+        numSamplesPublished += numSamples;
+    }
+
+    //==============================================================================
+    /** Returns the position that is being heard right now. */
+    double getPosition() const noexcept
+    {
+        return getPositionAt (Time::getHighResolutionTicks());
+    }
+
+    /** Returns the position that is heard at the given time. */
+    double getPositionAt (int64 now) const noexcept
+    {
+        return getSnapshot().getPosition (now, latencySeconds.get());
+    }
+
+    /** Records how far getPosition() is from the audio clock's position. Call
+        it on the message thread, once per drawn frame. */
+    void measureFrame() noexcept
+    {
+        measureFrameAt (Time::getHighResolutionTicks());
+    }
+
+    /** The same as measureFrame(), for a frame drawn at the given time. Returns
+        the error in milliseconds, or -1 if the playhead isn't moving or the
+        audio has stopped arriving. */
+    double measureFrameAt (int64 now) noexcept
+    {
+        const Snapshot snapshot (getSnapshot());
+
+        if (snapshot.rate <= 0.0 || now > snapshot.ticks + snapshot.maxTicks)
+            return -1.0;
+
+        const double latency = latencySeconds.get();
+        const double drawn = snapshot.getPosition (now, latency);
+        const double heard = snapshot.getClockPosition (now, latency);
+        const double errorMs = std::abs (drawn - heard) * 1000.0 / snapshot.rate;
+
+        meanErrorMs += (errorMs - meanErrorMs) / 16.0;
+        maxErrorMs = jmax (maxErrorMs, errorMs);
+        return errorMs;
+    }
+
+    /** Returns the smoothed and worst-case playhead errors, in milliseconds. */
+    float getMeanErrorMs() const noexcept       { return (float) meanErrorMs; }
+    float getMaxErrorMs() const noexcept        { return (float) maxErrorMs; }
+
+    void resetStatistics() noexcept             { meanErrorMs = maxErrorMs = 0.0; }
+
+private:
+    //==============================================================================
+    struct Snapshot
+    {
+        double position, rate, loopStart, loopEnd;
+        int64 ticks, clockTicks, maxTicks;
+
+        // Extrapolated from when the block arrived, but not for more than a
+        // couple of blocks, in case the audio stops arriving.
+        double getPosition (int64 now, double latencySeconds) const noexcept
+        {
+            return extrapolateFor (jmin (now - ticks, maxTicks), latencySeconds);
+        }
+
+        // Extrapolated from when the block was due by the audio clock.
+        double getClockPosition (int64 now, double latencySeconds) const noexcept
+        {
+            return extrapolateFor (now - clockTicks, latencySeconds);
+        }
+
+        double extrapolateFor (int64 elapsedTicks, double latencySeconds) const noexcept
+        {
+            return extrapolate (position, rate, Range<double> (loopStart, loopEnd),
+                                Time::highResolutionTicksToSeconds (elapsedTicks) - latencySeconds);
+        }
+    };
+
+    Snapshot getSnapshot() const noexcept
+    {
+        Snapshot s;
+
+        for (;;)
+        {
+            const int before = sequence.get();
+
+            s.position   = snapshotPosition.get();
+            s.rate       = snapshotRate.get();
+            s.ticks      = snapshotTicks.get();
+            s.clockTicks = snapshotClockTicks.get();
+            s.maxTicks   = snapshotMaxTicks.get();
+            s.loopStart  = snapshotLoopStart.get();
+            s.loopEnd    = snapshotLoopEnd.get();
+
+            if ((before & 1) == 0 && sequence.get() == before)
+                return s;
+        }
+    }
+
+    int64 samplesToTicks (int64 numSamples) const noexcept
+    {
+        return sampleRate > 0.0 ? Time::secondsToHighResolutionTicks (numSamples / sampleRate) : 0;
+    }
+
+    //==============================================================================
+    static double extrapolate (double position, double rate, Range<double> loopRange, double seconds) noexcept
+    {
+        position += seconds * rate;
+
+        if (! loopRange.isEmpty() && position >= loopRange.getEnd())
+            position = loopRange.getStart() + std::fmod (position - loopRange.getStart(), loopRange.getLength());
+
+        return position;
+    }
+
+    //==============================================================================
+    Atomic<int> sequence;
+    Atomic<double> snapshotPosition, snapshotRate, snapshotLoopStart, snapshotLoopEnd;
+    Atomic<int64> snapshotTicks, snapshotClockTicks, snapshotMaxTicks;
+
+    Atomic<double> latencySeconds;
+
+    // only touched by the audio thread
+    double sampleRate = 0.0;
+    int64 numSamplesPublished = 0, clockOrigin = 0;
+
+    // only touched by the message thread
+    double meanErrorMs = 0.0, maxErrorMs = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE (PlayheadClock)
+};
+
+#endif  // PLAYHEADCLOCK_H_INCLUDED
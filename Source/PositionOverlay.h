@@ -0,0 +1,227 @@
+#ifndef POSITIONOVERLAY_H_INCLUDED
+#define POSITIONOVERLAY_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Sits on top of a whole-file waveform and draws the playhead and loop region.
+
+    This started out as the SimplePositionOverlay from the tutorial. Clicking
+    still moves the playhead. Dragging selects a loop region, dragging either
+    edge of an existing region adjusts it, and double-clicking clears it.
+    Grabbing the playhead (or shift-dragging anywhere) scrubs.
+
+    The overlay doesn't talk to the audio code directly: the owner pushes the
+    file length and playhead position in, and is told about clicks and loop
+    changes through the Listener.
+*/
+class PositionOverlay : public Component
+{
+public:
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /** Called when the user clicks somewhere to move the playhead. */
+        virtual void positionOverlayClicked (double newPosition) = 0;
+
+        /** Called when a loop region has been selected, moved or cleared. */
+        virtual void loopRangeChanged (Range<double> newLoopRange) = 0;
+
+        /** Called when the user grabs the playhead, and then as it's dragged. */
+        virtual void scrubStarted (double position) = 0;
+        virtual void scrubMoved (double position) = 0;
+
+        /** Called when the playhead is let go of, at the position it ended up. */
+        virtual void scrubEnded (double position) = 0;
+    };
+
+    PositionOverlay (Listener& listenerToUse)
+       : listener (listenerToUse)
+    {
+    }
+
+    //==============================================================================
+    void setLength (double newLength)
+    {
+        if (length != newLength)
+        {
+            length = newLength;
+            repaint();
+        }
+    }
+
+    void setPlayheadPosition (double newPosition)
+    {
+        // while scrubbing, the playhead stays under the mouse
+        if (playheadPosition != newPosition && dragMode != scrubbing)
+        {
+            playheadPosition = newPosition;
+            repaint();
+        }
+    }
+
+    void setLoopRange (Range<double> newRange)
+    {
+        loopRange = newRange;
+        repaint();
+    }
+
+    Range<double> getLoopRange() const noexcept     { return loopRange; }
+
+    //==============================================================================
+    void paint (Graphics& g) override
+    {
+        if (length <= 0.0)
+            return;
+
+        if (! loopRange.isEmpty())
+        {
+            const float x1 = timeToX (loopRange.getStart());
+            const float x2 = timeToX (loopRange.getEnd());
+
+            g.setColour (Colours::yellow.withAlpha (0.25f));
+            g.fillRect (x1, 0.0f, x2 - x1, (float) getHeight());
+
+            g.setColour (Colours::orange);
+            g.drawLine (x1, 0.0f, x1, (float) getHeight(), 1.5f);
+            g.drawLine (x2, 0.0f, x2, (float) getHeight(), 1.5f);
+        }
+
+        const float drawPosition = timeToX (playheadPosition);
+
+        g.setColour (Colours::green);
+        g.drawLine (drawPosition, 0.0f, drawPosition, (float) getHeight(), 2.0f);
+    }
+
+    void mouseDown (const MouseEvent& event) override
+    {
+        dragMode = notDragging;
+
+        if (length <= 0.0)
+            return;
+
+        if (! loopRange.isEmpty() && ! event.mods.isShiftDown())
+        {
+            if (std::abs (event.position.x - timeToX (loopRange.getStart())) <= edgeGrabDistance)
+                dragMode = draggingLoopStart;
+            else if (std::abs (event.position.x - timeToX (loopRange.getEnd())) <= edgeGrabDistance)
+                dragMode = draggingLoopEnd;
+        }
+
+        if (dragMode == notDragging
+             && (event.mods.isShiftDown()
+                  || std::abs (event.position.x - timeToX (playheadPosition)) <= edgeGrabDistance))
+        {
+            dragMode = scrubbing;
+            playheadPosition = xToTime (event.position.x);
+            listener.scrubStarted (playheadPosition);
+            repaint();
+        }
+    }
+
+    void mouseDrag (const MouseEvent& event) override
+    {
+        if (length <= 0.0)
+            return;
+
+        const double time = xToTime (event.position.x);
+
+        switch (dragMode)
+        {
+            case notDragging:
+                if (event.getDistanceFromDragStart() < minimumDragDistance)
+                    return;
+
+                dragMode = selectingLoop;
+                // fall through
+
+            case selectingLoop:
+                loopRange = Range<double>::between (xToTime ((float) event.getMouseDownX()), time);
+                break;
+
+            case draggingLoopStart:
+                loopRange = Range<double>::between (time, loopRange.getEnd());
+                break;
+
+            case draggingLoopEnd:
+                loopRange = Range<double>::between (loopRange.getStart(), time);
+                break;
+
+            case scrubbing:
+                playheadPosition = time;
+                listener.scrubMoved (time);
+                break;
+
+            default:
+                jassertfalse;
+                break;
+        }
+
+        repaint();
+    }
+
+    void mouseUp (const MouseEvent& event) override
+    {
+        if (length <= 0.0)
+            return;
+
+        // The loop start is decoded when the region changes, so that is only
+        // done once the drag has finished rather than for every mouse move.
+        if (dragMode == scrubbing)
+            listener.scrubEnded (playheadPosition);
+        else if (! event.mouseWasDraggedSinceMouseDown())
+            listener.positionOverlayClicked (xToTime (event.position.x));
+        else if (dragMode != notDragging)
+            listener.loopRangeChanged (loopRange);
+
+        dragMode = notDragging;
+    }
+
+    void mouseDoubleClick (const MouseEvent&) override
+    {
+        if (! loopRange.isEmpty())
+        {
+            setLoopRange (Range<double>());
+            listener.loopRangeChanged (loopRange);
+        }
+    }
+
+private:
+    enum DragMode
+    {
+        notDragging,
+        selectingLoop,
+        draggingLoopStart,
+        draggingLoopEnd,
+        scrubbing
+    };
+
+    enum
+    {
+        edgeGrabDistance = 4,
+        minimumDragDistance = 3
+    };
+
+    float timeToX (double time) const
+    {
+        return length > 0.0 ? (float) (time / length * getWidth()) : 0.0f;
+    }
+
+    double xToTime (float x) const
+    {
+        return jlimit (0.0, length, x / (double) getWidth() * length);
+    }
+
+    Listener& listener;
+
+    double length = 0.0, playheadPosition = 0.0;
+    Range<double> loopRange;
+    DragMode dragMode = notDragging;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PositionOverlay)
+};
+
+#endif  // POSITIONOVERLAY_H_INCLUDED
@@ -0,0 +1,267 @@
+#ifndef PRELOADEDCLIPCACHE_H_INCLUDED
+#define PRELOADEDCLIPCACHE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DecodedBlockCache.h"
+
+//==============================================================================
+/*
+    Keeps short files fully decoded in memory, so that auditioning the same
+    clips over and over never touches the disk.
+
+    preload() queues a file for decoding on a low-priority background thread.
+    Files that decode to more than the size threshold are ignored. Finished
+    clips are kept until the memory budget is used up, then the least recently
+    played are dropped. A change message is sent whenever a clip becomes ready.
+
+    Clips are read through the DecodedBlockCache, so a file that's already
+    being played or drawn isn't decoded a second time, and the blocks decoded
+    here are there for the thumbnail and the analysis to use.
+*/
+class PreloadedClipCache : public ChangeBroadcaster,
+                           private Thread
+{
+public:
+    struct Clip  : public ReferenceCountedObject
+    {
+        typedef ReferenceCountedObjectPtr<Clip> Ptr;
+
+        File file;
+        AudioSampleBuffer samples;
+        double sampleRate = 0.0;
+        int64 lastUsed = 0;
+
+        size_t getSizeInBytes() const noexcept
+        {
+            return (size_t) samples.getNumChannels() * (size_t) samples.getNumSamples() * sizeof (float);
+        }
+    };
+
+    PreloadedClipCache (DecodedBlockCache& blockCacheToUse,
+                        size_t memoryBudgetInBytes = 128 * 1024 * 1024,
+                        size_t maximumClipSizeInBytes = 16 * 1024 * 1024)
+       : Thread ("Clip preloader"),
+         blockCache (blockCacheToUse),
+         memoryBudget (memoryBudgetInBytes),
+         maximumClipSize (maximumClipSizeInBytes)
+    {
+    }
+
+    ~PreloadedClipCache()
+    {
+        stopThread (2000);
+    }
+
+    //==============================================================================
+    /** Returns the decoded clip if it's in memory, or nullptr if it isn't (yet). */
+    Clip::Ptr getClip (const File& file)
+    {
+        const ScopedLock sl (lock);
+
+        for (int i = 0; i < clips.size(); ++i)
+        {
+            Clip* clip = clips.getObjectPointerUnchecked (i);
+
+            if (clip->file == file)
+            {
+                clip->lastUsed = ++useCounter;
+                return clip;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /** Queues a file to be decoded into memory, if it's short enough. */
+    void preload (const File& file)
+    {
+        {
+            const ScopedLock sl (lock);
+
+            if (queue.contains (file) || rejected.contains (file))
+                return;
+
+            for (int i = 0; i < clips.size(); ++i)
+                if (clips.getObjectPointerUnchecked (i)->file == file)
+                    return;
+
+            queue.add (file);
+        }
+
+        if (! isThreadRunning())
+            startThread (2);
+
+        notify();
+    }
+
+    void setMemoryBudget (size_t newBudgetInBytes)
+    {
+        const ScopedLock sl (lock);
+        memoryBudget = newBudgetInBytes;
+        evictClipsOverBudget (nullptr);
+    }
+
+    /** Files that would decode to more than this aren't preloaded. */
+    void setMaximumClipSize (size_t newMaximumInBytes)
+    {
+        const ScopedLock sl (lock);
+        maximumClipSize = newMaximumInBytes;
+        rejected.clear();
+    }
+
+    String getStatisticsDescription() const
+    {
+        const ScopedLock sl (lock);
+
+        return "Preloaded clips: " + String (clips.size()) + " clips, "
+                 + String (bytesUsed / (1024.0 * 1024.0), 1) + " of "
+                 + String (memoryBudget / (1024.0 * 1024.0), 1) + " MB";
+    }
+
+private:
+    //==============================================================================
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            File file;
+
+            {
+                const ScopedLock sl (lock);
+
+                if (queue.size() > 0)
+                    file = queue.removeAndReturn (0);
+            }
+
+            if (file == File())
+                wait (-1);
+            else
+                decodeClip (file);
+        }
+    }
+
+    void decodeClip (const File& file)
+    {
+        ScopedPointer<AudioFormatReader> reader (blockCache.createReaderFor (file));
+
+        const size_t size = reader != nullptr ? (size_t) reader->lengthInSamples * reader->numChannels * sizeof (float)
+                                              : 0;
+
+        if (reader == nullptr || size > getMaximumClipSize())
+        {
+            const ScopedLock sl (lock);
+            rejected.add (file);
+            return;
+        }
+
+        Clip::Ptr clip (new Clip());
+        clip->file = file;
+        clip->sampleRate = reader->sampleRate;
+        clip->samples.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+        reader->read (&clip->samples, 0, (int) reader->lengthInSamples, 0, true, true);
+
+        {
+            const ScopedLock sl (lock);
+
+            clip->lastUsed = ++useCounter;
+            clips.add (clip);
+            bytesUsed += clip->getSizeInBytes();
+            evictClipsOverBudget (clip);
+        }
+
+        sendChangeMessage();
+    }
+
+    size_t getMaximumClipSize() const
+    {
+        const ScopedLock sl (lock);
+        return maximumClipSize;
+    }
+
+    // Drops the least recently used clips until the total fits the budget.
+    // Clips that are still being played stay alive until their source lets go.
+    void evictClipsOverBudget (Clip* clipToKeep)
+    {
+        while (bytesUsed > memoryBudget)
+        {
+            int oldest = -1;
+
+            for (int i = 0; i < clips.size(); ++i)
+            {
+                Clip* clip = clips.getObjectPointerUnchecked (i);
+
+                if (clip != clipToKeep
+                     && (oldest < 0 || clip->lastUsed < clips.getObjectPointerUnchecked (oldest)->lastUsed))
+                    oldest = i;
+            }
+
+            if (oldest < 0)
+                break;
+
+            bytesUsed -= clips.getObjectPointerUnchecked (oldest)->getSizeInBytes();
+            clips.remove (oldest);
+        }
+    }
+
+    //==============================================================================
+    DecodedBlockCache& blockCache;
+
+    CriticalSection lock;
+    ReferenceCountedArray<Clip> clips;
+    Array<File> queue, rejected;
+    size_t memoryBudget, maximumClipSize, bytesUsed = 0;
+    int64 useCounter = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PreloadedClipCache)
+};
+
+//==============================================================================
+/*
+    Plays a clip from a PreloadedClipCache straight out of memory.
+*/
+class ClipAudioSource : public PositionableAudioSource
+{
+public:
+    ClipAudioSource (PreloadedClipCache::Clip* clipToPlay)
+       : clip (clipToPlay)
+    {
+        jassert (clip != nullptr);
+    }
+
+    void prepareToPlay (int, double) override   {}
+    void releaseResources() override            {}
+
+    void getNextAudioBlock (const AudioSourceChannelInfo& info) override
+    {
+        const AudioSampleBuffer& samples = clip->samples;
+        const int numAvailable = (int) jlimit ((int64) 0, (int64) info.numSamples,
+                                               samples.getNumSamples() - position);
+
+        for (int ch = 0; ch < info.buffer->getNumChannels(); ++ch)
+        {
+            if (numAvailable > 0)
+                info.buffer->copyFrom (ch, info.startSample, samples,
+                                       ch % samples.getNumChannels(), (int) position, numAvailable);
+
+            if (numAvailable < info.numSamples)
+                info.buffer->clear (ch, info.startSample + numAvailable, info.numSamples - numAvailable);
+        }
+
+        position += info.numSamples;
+    }
+
+    void setNextReadPosition (int64 newPosition) override   { position = newPosition; }
+    int64 getNextReadPosition() const override              { return position; }
+    int64 getTotalLength() const override                   { return clip->samples.getNumSamples(); }
+    bool isLooping() const override                         { return false; }
+
+    double getSampleRate() const noexcept                   { return clip->sampleRate; }
+
+private:
+    PreloadedClipCache::Clip::Ptr clip;
+    int64 position = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClipAudioSource)
+};
+
+#endif  // PRELOADEDCLIPCACHE_H_INCLUDED
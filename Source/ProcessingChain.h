@@ -0,0 +1,385 @@
+#ifndef PROCESSINGCHAIN_H_INCLUDED
+#define PROCESSINGCHAIN_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Tracer.h"
+
+//==============================================================================
+/*
+    A base for the effects in a ProcessingChain. It fills in the parts of
+    AudioProcessor that only matter to plugin hosts, so an effect just needs a
+    name, prepareToPlay() and processBlock().
+*/
+class ChainProcessor : public AudioProcessor
+{
+public:
+    ChainProcessor() {}
+
+    void releaseResources() override                            {}
+    double getTailLengthSeconds() const override                { return 0.0; }
+    bool acceptsMidi() const override                           { return false; }
+    bool producesMidi() const override                          { return false; }
+    AudioProcessorEditor* createEditor() override               { return nullptr; }
+    bool hasEditor() const override                             { return false; }
+    int getNumPrograms() override                               { return 1; }
+    int getCurrentProgram() override                            { return 0; }
+    void setCurrentProgram (int) override                       {}
+    const String getProgramName (int) override                  { return String(); }
+    void changeProgramName (int, const String&) override        {}
+    void getStateInformation (MemoryBlock&) override            {}
+    void setStateInformation (const void*, int) override        {}
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChainProcessor)
+};
+
+//==============================================================================
+/*
+    Output gain, ramped across a block whenever it changes.
+*/
+class GainProcessor : public ChainProcessor
+{
+public:
+    GainProcessor() {}
+
+    /** Can be called from any thread. */
+    void setGain (float newGain) noexcept       { gain.set (newGain); }
+
+    const String getName() const override       { return "Gain"; }
+
+    void prepareToPlay (double, int) override
+    {
+        currentGain = gain.get();
+    }
+
+    void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+    {
+        const float targetGain = gain.get();
+
+        if (targetGain == currentGain)
+        {
+            buffer.applyGain (targetGain);
+        }
+        else
+        {
+            buffer.applyGainRamp (0, buffer.getNumSamples(), currentGain, targetGain);
+            currentGain = targetGain;
+        }
+    }
+
+private:
+    Atomic<float> gain { 1.0f };
+    float currentGain = 1.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GainProcessor)
+};
+
+//==============================================================================
+/*
+    A list of AudioProcessors that the playback output passes through in turn.
+
+    Processors are added, removed and bypassed on the message thread. Each
+    change builds a new list of nodes that the audio thread picks up at the
+    start of its next block, using the same try-locked swap as the loop region,
+    so it never waits. A removed processor may still be in its processBlock()
+    until then, so it's kept aside, and only released and deleted on the
+    message thread once the audio thread has picked up a list without it.
+
+    A bypassed node is skipped before it's timed, so it costs nothing. For the
+    others, the audio thread adds up how long each processBlock() call takes.
+    getProfileDescription() turns that into an average and worst time per
+    block, and a share of the real-time budget.
+*/
+class ProcessingChain  : private Timer
+{
+public:
+    ProcessingChain() {}
+
+    ~ProcessingChain()
+    {
+        releaseResources();
+    }
+
+    //==============================================================================
+    /** Adds a processor at the given index, or at the end. The chain owns it. */
+    void addProcessor (AudioProcessor* processor, int index = -1)
+    {
+        Node::Ptr node (new Node (processor));
+
+        const ScopedLock sl (listLock);
+
+        if (sampleRate > 0.0)
+            prepareNode (*node);
+
+        nodes.insert (index, node);
+        publishNodes();
+    }
+
+    void removeProcessor (int index)
+    {
+        const ScopedLock sl (listLock);
+
+        if (Node::Ptr node = nodes[index])
+        {
+            nodes.remove (index);
+            publishNodes();
+
+            if (sampleRate > 0.0)
+            {
+                node->retiredInVersion = publishedVersion;
+                retiredNodes.add (node);
+                startTimer (20);
+            }
+        }
+    }
+
+    int getNumProcessors() const                    { const ScopedLock sl (listLock); return nodes.size(); }
+
+    AudioProcessor* getProcessor (int index) const
+    {
+        const ScopedLock sl (listLock);
+        const Node* node = nodes[index];
+        return node != nullptr ? node->processor.get() : nullptr;
+    }
+
+    void setBypassed (int index, bool shouldBeBypassed)
+    {
+        const ScopedLock sl (listLock);
+
+        if (Node* node = nodes[index])
+            node->bypassed.set (shouldBeBypassed ? 1 : 0);
+    }
+
+    bool isBypassed (int index) const
+    {
+        const ScopedLock sl (listLock);
+        const Node* node = nodes[index];
+        return node != nullptr && node->bypassed.get() != 0;
+    }
+
+    //==============================================================================
+    void prepareToPlay (double newSampleRate, int newBlockSize, int newNumChannels)
+    {
+        const ScopedLock sl (listLock);
+
+        sampleRate = newSampleRate;
+        blockSize = newBlockSize;
+        numChannels = newNumChannels;
+
+        for (int i = 0; i < nodes.size(); ++i)
+            prepareNode (*nodes.getObjectPointerUnchecked (i));
+    }
+
+    void releaseResources()
+    {
+        const ScopedLock sl (listLock);
+
+        // the audio has stopped, so nothing can still be using these
+        releaseRetiredNodes (true);
+
+        if (sampleRate > 0.0)
+            for (int i = 0; i < nodes.size(); ++i)
+                nodes.getObjectPointerUnchecked (i)->processor->releaseResources();
+
+        sampleRate = 0.0;
+    }
+
+    /** Called on the audio thread to process a block in place. */
+    void process (const AudioSourceChannelInfo& info) noexcept
+    {
+        TRACE_SCOPE ("Processing chain");
+
+        updateNodes();
+
+        if (activeNodes == nullptr)
+            return;
+
+        // refers to the caller's channels, so nothing is allocated or copied
+        AudioSampleBuffer block (info.buffer->getArrayOfWritePointers(), info.buffer->getNumChannels(),
+                                 info.startSample, info.numSamples);
+
+        const bool resetProfiles = resetPending.compareAndSetBool (0, 1);
+
+        for (int i = 0; i < activeNodes->size(); ++i)
+        {
+            Node& node = *activeNodes->getObjectPointerUnchecked (i);
+
+            if (resetProfiles)
+                node.profile.clear();
+
+            if (node.bypassed.get() != 0)
+                continue;
+
+            const int64 start = Time::getHighResolutionTicks();
+            node.processor->processBlock (block, midiMessages);
+            node.profile.addBlock (Time::getHighResolutionTicks() - start, info.numSamples);
+
+            midiMessages.clear();
+        }
+    }
+
+    //==============================================================================
+    /** Returns a line per processor with how long it has been taking. */
+    String getProfileDescription() const
+    {
+        const ScopedLock sl (listLock);
+        String text;
+
+        for (int i = 0; i < nodes.size(); ++i)
+        {
+            const Node& node = *nodes.getObjectPointerUnchecked (i);
+            const int64 numBlocks = node.profile.numBlocks.get();
+            const int64 numSamples = node.profile.numSamples.get();
+
+            text << node.processor->getName() << ": ";
+
+            if (node.bypassed.get() != 0)
+                text << "bypassed";
+            else if (numBlocks == 0 || sampleRate <= 0.0)
+                text << "idle";
+            else
+                text << String (ticksToMicroseconds (node.profile.totalTicks.get()) / numBlocks, 1) << " us mean, "
+                     << String (ticksToMicroseconds (node.profile.peakTicks.get()), 1) << " us max, "
+                     << String (100.0 * Time::highResolutionTicksToSeconds (node.profile.totalTicks.get())
+                                  / (numSamples / sampleRate), 2) << "% CPU";
+
+            text << newLine;
+        }
+
+        return text.trimEnd();
+    }
+
+    /** Asks the audio thread to clear the timings at the start of its next block. */
+    void resetProfiles()                            { resetPending.set (1); }
+
+private:
+    //==============================================================================
+    struct Profile
+    {
+        void addBlock (int64 ticks, int samples) noexcept
+        {
+            totalTicks.set (totalTicks.get() + ticks);
+            numSamples.set (numSamples.get() + samples);
+            numBlocks.set (numBlocks.get() + 1);
+
+            if (ticks > peakTicks.get())
+                peakTicks.set (ticks);
+        }
+
+        void clear() noexcept
+        {
+            totalTicks.set (0);
+            peakTicks.set (0);
+            numSamples.set (0);
+            numBlocks.set (0);
+        }
+
+        // written by the audio thread only
+        Atomic<int64> totalTicks, peakTicks, numSamples, numBlocks;
+    };
+
+    struct Node  : public ReferenceCountedObject
+    {
+        typedef ReferenceCountedObjectPtr<Node> Ptr;
+
+        Node (AudioProcessor* p) : processor (p) {}
+
+        const ScopedPointer<AudioProcessor> processor;
+        Atomic<int> bypassed;
+        Profile profile;
+        int retiredInVersion = 0;
+    };
+
+    typedef ReferenceCountedArray<Node> NodeList;
+
+    static double ticksToMicroseconds (double ticks) noexcept
+    {
+        return ticks * 1.0e6 / (double) Time::getHighResolutionTicksPerSecond();
+    }
+
+    void prepareNode (Node& node)
+    {
+        node.processor->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+        node.processor->prepareToPlay (sampleRate, blockSize);
+    }
+
+    // Called under listLock whenever the list changes.
+    void publishNodes()
+    {
+        ScopedPointer<NodeList> newList (new NodeList (nodes));
+        ++publishedVersion;
+
+        {
+            const SpinLock::ScopedLockType lock (swapLock);
+            pendingNodes.swapWith (newList);
+            pendingVersion = publishedVersion;
+            nodesChanged.set (1);
+        }
+
+        // newList now holds a list the audio thread has finished with (or one it
+        // never saw), and any processor only it referred to is deleted here
+    }
+
+    void updateNodes() noexcept
+    {
+        if (nodesChanged.get() == 0)
+            return;
+
+        const SpinLock::ScopedTryLockType lock (swapLock);
+
+        if (lock.isLocked())
+        {
+            activeNodes.swapWith (pendingNodes);
+            activeVersion.set (pendingVersion);
+            nodesChanged.set (0);
+        }
+    }
+
+    // Called under listLock. Releases the removed processors that the audio
+    // thread has finished with; they're deleted along with the last list that
+    // refers to them.
+    void releaseRetiredNodes (bool audioHasStopped)
+    {
+        for (int i = retiredNodes.size(); --i >= 0;)
+        {
+            Node& node = *retiredNodes.getObjectPointerUnchecked (i);
+
+            if (audioHasStopped || activeVersion.get() - node.retiredInVersion >= 0)
+            {
+                if (sampleRate > 0.0)
+                    node.processor->releaseResources();
+
+                retiredNodes.remove (i);
+            }
+        }
+
+        if (retiredNodes.size() == 0)
+            stopTimer();
+    }
+
+    void timerCallback() override
+    {
+        const ScopedLock sl (listLock);
+        releaseRetiredNodes (false);
+    }
+
+    //==============================================================================
+    CriticalSection listLock;
+    NodeList nodes, retiredNodes;
+    int publishedVersion = 0;
+    double sampleRate = 0.0;
+    int blockSize = 0, numChannels = 2;
+
+    SpinLock swapLock;
+    ScopedPointer<NodeList> pendingNodes;
+    int pendingVersion = 0;
+    Atomic<int> nodesChanged, resetPending, activeVersion;
+
+    // only touched by the audio thread
+    ScopedPointer<NodeList> activeNodes;
+    MidiBuffer midiMessages;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProcessingChain)
+};
+
+#endif  // PROCESSINGCHAIN_H_INCLUDED
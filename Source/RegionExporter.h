@@ -0,0 +1,322 @@
+#ifndef REGIONEXPORTER_H_INCLUDED
+#define REGIONEXPORTER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Writes part of an audio file to a new file, on a background thread with a
+    progress window, and reports how fast it went when it's done.
+
+    If the source is an uncompressed WAV (PCM or float) and the destination is
+    a WAV too, nothing is decoded. A new header is written with the source's
+    own 'fmt ' chunk, and the region's bytes are copied straight out of the
+    source's data chunk, so the samples are bit-for-bit the same. Other chunks,
+    such as cue points, are left behind, since their positions no longer apply.
+
+    Anything else is decoded, a block at a time and only over the region, and
+    written through an AudioFormatWriter. The destination's extension decides
+    the format, falling back to WAV when there's no writer for it.
+
+    Everything is written to a temporary file next to the destination, which
+    only replaces it once the export has succeeded. A cancelled or failed export
+    leaves any existing file alone.
+
+    Use it with launchThread(). It deletes itself once it has finished.
+*/
+class RegionExporter : public ThreadWithProgressWindow
+{
+public:
+    RegionExporter (AudioFormatManager& formatManagerToUse, const File& sourceFile,
+                    const File& destinationFile, Range<double> regionToExport)
+       : ThreadWithProgressWindow ("Exporting " + destinationFile.getFileName(), true, true),
+         formatManager (formatManagerToUse),
+         source (sourceFile),
+         destination (destinationFile),
+         region (regionToExport)
+    {
+    }
+
+    //==============================================================================
+    void run() override
+    {
+        const int64 start = Time::getHighResolutionTicks();
+        TemporaryFile temp (destination);
+
+        if (! copyWavBytes (temp.getFile()))
+            decodeAndWrite (temp.getFile());
+
+        if (! threadShouldExit() && error.isEmpty() && ! temp.overwriteTargetFileWithTemporary())
+            error = "Couldn't replace " + destination.getFullPathName();
+
+        seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+    }
+
+    void threadComplete (bool userPressedCancel) override
+    {
+        const String report (userPressedCancel ? String ("Export cancelled")
+                                               : error.isNotEmpty() ? error : getReport());
+        Logger::writeToLog (report);
+
+        if (! userPressedCancel)
+            AlertWindow::showMessageBoxAsync (error.isNotEmpty() ? AlertWindow::WarningIcon : AlertWindow::InfoIcon,
+                                              "Export region", report);
+        delete this;
+    }
+
+private:
+    //==============================================================================
+    enum { bytesPerCopy = 1 << 20, samplesPerBlock = 65536 };
+
+    struct WavLayout
+    {
+        MemoryBlock formatChunk;
+        int64 dataStart = 0, dataSize = 0;
+        int formatTag = 0, blockAlign = 0;
+        double sampleRate = 0.0;
+    };
+
+    static int chunkName (const char* name) noexcept
+    {
+        return (int) ByteOrder::littleEndianInt (name);
+    }
+
+    // Finds the 'fmt ' and 'data' chunks. Returns false if it isn't a RIFF WAV.
+    static bool readWavLayout (InputStream& in, WavLayout& layout)
+    {
+        if (in.readInt() != chunkName ("RIFF"))
+            return false;
+
+        in.readInt();
+
+        if (in.readInt() != chunkName ("WAVE"))
+            return false;
+
+        while (! in.isExhausted() && (layout.formatChunk.getSize() == 0 || layout.dataStart == 0))
+        {
+            const int id = in.readInt();
+            const int64 size = (int64) (uint32) in.readInt();
+            const int64 chunkStart = in.getPosition();
+
+            if (id == chunkName ("fmt ") && size >= 16 && size < 1024)
+            {
+                layout.formatChunk.setSize ((size_t) size);
+                in.read (layout.formatChunk.getData(), (int) size);
+
+                const uint8* const fmt = static_cast<const uint8*> (layout.formatChunk.getData());
+                layout.formatTag = ByteOrder::littleEndianShort (fmt);
+                layout.sampleRate = ByteOrder::littleEndianInt (fmt + 4);
+                layout.blockAlign = ByteOrder::littleEndianShort (fmt + 12);
+
+                // WAVE_FORMAT_EXTENSIBLE keeps the real format in its sub-format GUID
+                if (layout.formatTag == 0xfffe && size >= 26)
+                    layout.formatTag = ByteOrder::littleEndianShort (fmt + 24);
+            }
+            else if (id == chunkName ("data"))
+            {
+                layout.dataStart = chunkStart;
+                layout.dataSize = jmin (size, in.getTotalLength() - chunkStart);
+            }
+
+            in.setPosition (chunkStart + size + (size & 1));
+        }
+
+        return layout.formatChunk.getSize() > 0 && layout.dataStart > 0;
+    }
+
+    // Returns false if the source can't be copied without decoding, so that
+    // the caller can fall back to that.
+    bool copyWavBytes (const File& output)
+    {
+        if (! destination.hasFileExtension ("wav;wave"))
+            return false;
+
+        FileInputStream in (source);
+        WavLayout layout;
+
+        if (in.failedToOpen() || ! readWavLayout (in, layout))
+            return false;
+
+        const bool isUncompressed = (layout.formatTag == 1 || layout.formatTag == 3);
+
+        if (! isUncompressed || layout.blockAlign <= 0 || layout.sampleRate <= 0.0)
+            return false;
+
+        const int64 numFrames = layout.dataSize / layout.blockAlign;
+        const Range<int64> frames (getSampleRange (layout.sampleRate, numFrames));
+        const int64 numBytes = frames.getLength() * layout.blockAlign;
+        const int64 fmtSize = (int64) layout.formatChunk.getSize();
+        const int64 riffSize = 4 + 8 + fmtSize + (fmtSize & 1) + 8 + numBytes + (numBytes & 1);
+
+        // RIFF sizes are 32 bits; anything bigger is written as RF64 by the WAV writer
+        if (riffSize > 0xffffffffLL)
+            return false;
+
+        method = "copied";
+        audioSeconds = frames.getLength() / layout.sampleRate;
+
+        FileOutputStream out (output);
+
+        if (out.failedToOpen())
+        {
+            error = "Couldn't write to " + destination.getFullPathName();
+            return true;
+        }
+
+        out.writeInt (chunkName ("RIFF"));
+        out.writeInt ((int) (uint32) riffSize);
+        out.writeInt (chunkName ("WAVE"));
+        out.writeInt (chunkName ("fmt "));
+        out.writeInt ((int) fmtSize);
+        out.write (layout.formatChunk.getData(), layout.formatChunk.getSize());
+
+        if ((fmtSize & 1) != 0)
+            out.writeByte (0);
+
+        out.writeInt (chunkName ("data"));
+        out.writeInt ((int) (uint32) numBytes);
+
+        in.setPosition (layout.dataStart + frames.getStart() * layout.blockAlign);
+        HeapBlock<char> buffer ((size_t) bytesPerCopy);
+
+        for (int64 done = 0; done < numBytes;)
+        {
+            if (threadShouldExit())
+                return true;
+
+            const int num = (int) jmin ((int64) bytesPerCopy, numBytes - done);
+
+            if (in.read (buffer, num) != num || ! out.write (buffer, (size_t) num))
+            {
+                error = "Couldn't copy the audio to " + destination.getFullPathName();
+                return true;
+            }
+
+            done += num;
+            setProgress (done / (double) numBytes);
+        }
+
+        if ((numBytes & 1) != 0)
+            out.writeByte (0);
+
+        out.flush();
+
+        if (out.getStatus().failed())
+            error = "Couldn't write to " + destination.getFullPathName();
+
+        bytesWritten = out.getPosition();
+        return true;
+    }
+
+    void decodeAndWrite (const File& output)
+    {
+        method = "decoded";
+
+        ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (source));
+
+        if (reader == nullptr)
+        {
+            error = "Couldn't read " + source.getFullPathName();
+            return;
+        }
+
+        const Range<int64> samples (getSampleRange (reader->sampleRate, reader->lengthInSamples));
+        audioSeconds = samples.getLength() / reader->sampleRate;
+
+        ScopedPointer<FileOutputStream> stream (output.createOutputStream());
+
+        if (stream == nullptr)
+        {
+            error = "Couldn't write to " + destination.getFullPathName();
+            return;
+        }
+
+        ScopedPointer<AudioFormatWriter> writer (createWriter (*stream, *reader));
+
+        if (writer == nullptr)
+        {
+            error = "Couldn't create a writer for " + destination.getFileName();
+            return;
+        }
+
+        stream.release();   // the writer owns it now
+
+        AudioSampleBuffer block ((int) reader->numChannels, samplesPerBlock);
+
+        for (int64 pos = samples.getStart(); pos < samples.getEnd(); pos += samplesPerBlock)
+        {
+            if (threadShouldExit())
+                return;
+
+            const int num = (int) jmin ((int64) samplesPerBlock, samples.getEnd() - pos);
+            reader->read (&block, 0, num, pos, true, true);
+
+            if (! writer->writeFromAudioSampleBuffer (block, 0, num))
+            {
+                error = "Couldn't write to " + destination.getFullPathName();
+                return;
+            }
+
+            setProgress ((pos + num - samples.getStart()) / (double) samples.getLength());
+        }
+
+        writer = nullptr;   // finishes the header and closes the file
+        bytesWritten = output.getSize();
+    }
+
+    // Uses the destination's format if there's a writer for it at the source's
+    // bit depth (or the nearest it offers), otherwise WAV.
+    AudioFormatWriter* createWriter (FileOutputStream& stream, const AudioFormatReader& reader)
+    {
+        if (AudioFormat* format = formatManager.findFormatForFileExtension (destination.getFileExtension()))
+        {
+            const Array<int> depths (format->getPossibleBitDepths());
+            int bits = depths.isEmpty() ? 16 : depths.getLast();
+
+            for (int i = 0; i < depths.size(); ++i)
+                if (depths[i] <= (int) reader.bitsPerSample)
+                    bits = depths[i];
+
+            if (AudioFormatWriter* writer = format->createWriterFor (&stream, reader.sampleRate, reader.numChannels,
+                                                                     bits, StringPairArray(), 0))
+                return writer;
+        }
+
+        WavAudioFormat wav;
+        return wav.createWriterFor (&stream, reader.sampleRate, reader.numChannels,
+                                    jlimit (16, 32, (int) reader.bitsPerSample), StringPairArray(), 0);
+    }
+
+    Range<int64> getSampleRange (double sampleRate, int64 length) const
+    {
+        const int64 start = jlimit ((int64) 0, length, (int64) (region.getStart() * sampleRate + 0.5));
+        const int64 end = jlimit (start, length, (int64) (region.getEnd() * sampleRate + 0.5));
+        return Range<int64> (start, end);
+    }
+
+    String getReport() const
+    {
+        const double megabytes = bytesWritten / (1024.0 * 1024.0);
+
+        String report;
+        report << "Exported " << String (audioSeconds, 2) << " s of audio (" << String (megabytes, 1)
+               << " MB) to " << destination.getFileName() << newLine
+               << method << " in " << String (seconds, 3) << " s: "
+               << String (megabytes / jmax (1.0e-9, seconds), 1) << " MB/s, "
+               << String (audioSeconds / jmax (1.0e-9, seconds), 0) << "x real time";
+        return report;
+    }
+
+    //==============================================================================
+    AudioFormatManager& formatManager;
+    const File source, destination;
+    const Range<double> region;
+
+    String error, method;
+    double seconds = 0.0, audioSeconds = 0.0;
+    int64 bytesWritten = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RegionExporter)
+};
+
+#endif  // REGIONEXPORTER_H_INCLUDED
@@ -0,0 +1,275 @@
+#ifndef SCRUBAUDIOSOURCE_H_INCLUDED
+#define SCRUBAUDIOSOURCE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DecodedBlockCache.h"
+
+//==============================================================================
+/*
+    Plays the audio under the mouse while the playhead is being dragged.
+
+    A few seconds of the file around the cursor are decoded on a TimeSliceThread
+    and handed to the audio thread as a ready-made block. Each audio callback
+    reads the latest mouse position and sets the playback rate so that the read
+    position arrives there by the end of the block, so a mouse movement is heard
+    within one buffer. The rate is ramped across the block and the samples are
+    read with 4-point Hermite interpolation. That makes fast drags sound like a
+    tape being scrubbed, and holding the mouse still fades to silence.
+
+    Changing the file withdraws any block decoded from the old one, and the
+    audio thread picks up the new file's sample rate in the same swap, so it
+    never plays a block at the wrong rate.
+*/
+class ScrubAudioSource : public AudioSource,
+                         private TimeSliceClient
+{
+public:
+    ScrubAudioSource (DecodedBlockCache& cacheToUse, TimeSliceThread& threadToUse)
+       : blockCache (cacheToUse),
+         thread (threadToUse)
+    {
+        thread.addTimeSliceClient (this);
+    }
+
+    ~ScrubAudioSource()
+    {
+        thread.removeTimeSliceClient (this);
+    }
+
+    //==============================================================================
+    void setFile (const File& file)
+    {
+        const ScopedLock sl (readerLock);
+
+        reader = blockCache.createReaderFor (file);
+        decodedStart = decodedEnd = 0;
+
+        // an empty block tells the audio thread to drop the one it's playing
+        const SpinLock::ScopedLockType lock (blockLock);
+        fileSampleRate.set (reader != nullptr ? reader->sampleRate : 0.0);
+        pendingBlock = nullptr;
+        blockReady.set (1);
+    }
+
+    /** Starts scrubbing from the given position, in seconds. */
+    void beginScrub (double position)
+    {
+        const int64 samplePosition = (int64) (position * fileSampleRate.get());
+
+        targetPosition.set (samplePosition);
+        currentPosition.set (samplePosition);
+        startRequested.set (1);
+        ending.set (0);
+        scrubbing.set (1);
+
+        thread.moveToFrontOfQueue (this);
+    }
+
+    /** Moves the point that playback is being dragged towards, in seconds. */
+    void setScrubPosition (double position)
+    {
+        targetPosition.set ((int64) (position * fileSampleRate.get()));
+    }
+
+    /** Fades out and stops scrubbing. isScrubbing() carries on returning true
+        until the fade has been rendered. */
+    void endScrub()
+    {
+        ending.set (1);
+    }
+
+    bool isScrubbing() const noexcept       { return scrubbing.get() != 0; }
+
+    /** Returns the position being played, in seconds. */
+    double getCurrentPosition() const noexcept
+    {
+        const double rate = fileSampleRate.get();
+        return rate > 0.0 ? currentPosition.get() / rate : 0.0;
+    }
+
+    //==============================================================================
+    void prepareToPlay (int, double newSampleRate) override
+    {
+        sampleRate = newSampleRate;
+    }
+
+    void releaseResources() override {}
+
+    void getNextAudioBlock (const AudioSourceChannelInfo& info) override
+    {
+        info.clearActiveBufferRegion();
+        updateBlock();
+
+        if (sampleRate <= 0.0 || blockSampleRate <= 0.0)
+        {
+            if (ending.compareAndSetBool (0, 1))
+                scrubbing.set (0);
+
+            return;
+        }
+
+        if (startRequested.compareAndSetBool (0, 1))
+        {
+            readPosition = (double) targetPosition.get();
+            rate = 0.0;
+            gain = 0.0f;
+        }
+
+        const double normalRate = blockSampleRate / sampleRate;
+        const double maxRate = maxSpeed * normalRate;
+        const int numSamples = info.numSamples;
+
+        // Ramping from the current rate to (distance - rate / 2) lands exactly on a
+        // stationary target after two blocks without overshooting it, and follows
+        // a moving one about one and a half blocks behind.
+        const double distance = (targetPosition.get() - readPosition) / numSamples;
+        const double targetRate = jlimit (-maxRate, maxRate, distance - 0.5 * rate);
+        const double rateStep = (targetRate - rate) / numSamples;
+
+        // full volume from quarter speed upwards, fading out as the mouse stops
+        const bool fadingOut = ending.get() != 0;
+        const float targetGain = fadingOut ? 0.0f
+                                           : (float) jmin (1.0, 4.0 * std::abs (targetRate) / normalRate);
+        const float gainStep = (targetGain - gain) / numSamples;
+
+        const int numOutputChannels = info.buffer->getNumChannels();
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            rate += rateStep;
+            gain += gainStep;
+            readPosition += rate;
+
+            if (block == nullptr)
+                continue;
+
+            const double offset = readPosition - block->start;
+            const int index = (int) std::floor (offset);
+
+            if (index < 1 || index + 2 >= block->samples.getNumSamples())
+                continue;
+
+            const float frac = (float) (offset - index);
+
+            for (int ch = 0; ch < numOutputChannels; ++ch)
+            {
+                const float* data = block->samples.getReadPointer (ch % block->samples.getNumChannels(), index - 1);
+                info.buffer->setSample (ch, info.startSample + i, gain * hermite (data, frac));
+            }
+        }
+
+        currentPosition.set ((int64) readPosition);
+
+        if (fadingOut)
+        {
+            ending.set (0);
+            scrubbing.set (0);
+        }
+    }
+
+private:
+    //==============================================================================
+    struct DecodedBlock
+    {
+        int64 start = 0;
+        AudioSampleBuffer samples;
+    };
+
+    enum
+    {
+        maxSpeed = 4,       // fastest scrub, as a multiple of normal speed
+        cacheSeconds = 4    // how much is decoded around the cursor
+    };
+
+    static float hermite (const float* y, float t) noexcept
+    {
+        const float c1 = 0.5f * (y[2] - y[0]);
+        const float c2 = y[0] - 2.5f * y[1] + 2.0f * y[2] - 0.5f * y[3];
+        const float c3 = 0.5f * (y[3] - y[0]) + 1.5f * (y[1] - y[2]);
+
+        return ((c3 * t + c2) * t + c1) * t + y[1];
+    }
+
+    void updateBlock() noexcept
+    {
+        if (blockReady.get() == 0)
+            return;
+
+        const SpinLock::ScopedTryLockType lock (blockLock);
+
+        if (lock.isLocked())
+        {
+            // the old block goes back to the decoding thread to be reused
+            block.swapWith (pendingBlock);
+            blockSampleRate = fileSampleRate.get();
+            blockReady.set (0);
+        }
+    }
+
+    int useTimeSlice() override
+    {
+        if (! isScrubbing())
+            return 50;
+
+        const ScopedLock sl (readerLock);
+
+        if (reader == nullptr)
+            return 50;
+
+        const int64 cacheLength = (int64) (cacheSeconds * fileSampleRate.get());
+        const int64 position = currentPosition.get();
+        const int64 target = targetPosition.get();
+
+        // re-centre once the cursor gets within a quarter of the cache of either end
+        const int64 margin = cacheLength / 4;
+
+        if (jmin (position, target) - margin >= decodedStart
+             && jmax (position, target) + margin <= decodedEnd)
+            return 10;
+
+        if (decodeBlock == nullptr)
+            decodeBlock = new DecodedBlock();
+
+        decodeBlock->start = jmax ((int64) 0, target - cacheLength / 2);
+        decodeBlock->samples.setSize (2, (int) cacheLength, false, false, true);
+        reader->read (&decodeBlock->samples, 0, (int) cacheLength, decodeBlock->start, true, true);
+
+        decodedStart = decodeBlock->start;
+        decodedEnd = decodedStart + cacheLength;
+
+        const SpinLock::ScopedLockType lock (blockLock);
+        pendingBlock.swapWith (decodeBlock);
+        blockReady.set (1);
+
+        return 0;
+    }
+
+    //==============================================================================
+    DecodedBlockCache& blockCache;
+    TimeSliceThread& thread;
+
+    CriticalSection readerLock;
+    ScopedPointer<AudioFormatReader> reader;
+
+    // used by the decoding thread, under readerLock
+    ScopedPointer<DecodedBlock> decodeBlock;
+    int64 decodedStart = 0, decodedEnd = 0;
+
+    SpinLock blockLock;
+    ScopedPointer<DecodedBlock> pendingBlock;
+    Atomic<int> blockReady;
+    Atomic<double> fileSampleRate;
+
+    Atomic<int64> targetPosition, currentPosition;
+    Atomic<int> scrubbing, ending, startRequested;
+
+    // only touched by the audio thread
+    ScopedPointer<DecodedBlock> block;
+    double sampleRate = 0.0, blockSampleRate = 0.0;
+    double readPosition = 0.0, rate = 0.0;
+    float gain = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScrubAudioSource)
+};
+
+#endif  // SCRUBAUDIOSOURCE_H_INCLUDED
@@ -0,0 +1,318 @@
+#ifndef SILENCEINDEX_H_INCLUDED
+#define SILENCEINDEX_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DecodedBlockCache.h"
+#include "Tracer.h"
+#include "VectorOps.h"
+
+//==============================================================================
+/*
+    The silent stretches of a file, as a sorted list of time ranges.
+
+    The file is split into windows of windowSize samples. A window is silent if
+    no sample on any channel is above -60 dBFS. Runs of silent windows that last
+    at least minSilenceMs become regions. Since the regions are sorted and don't
+    overlap, finding the one at a given time is a binary search.
+
+    The windows are scanned in chunks by the SilenceIndexCache's thread pool.
+    The job that finishes the last chunk builds the regions, and after that the
+    index never changes. Until then it is empty, so it can be read from any
+    thread, including the audio thread, once isReady() returns true.
+*/
+class SilenceIndex : public ReferenceCountedObject
+{
+public:
+    typedef ReferenceCountedObjectPtr<SilenceIndex> Ptr;
+
+    SilenceIndex (double fileSampleRate, int64 fileLength)
+        : sampleRate (fileSampleRate),
+          length (fileLength),
+          numWindows ((int) ((fileLength + windowSize - 1) / windowSize)),
+          silentWindows ((size_t) jmax (1, numWindows), true)
+    {
+        for (int first = 0; first < numWindows; first += windowsPerChunk)
+            chunks.add (new Chunk (first, jmin ((int) windowsPerChunk, numWindows - first)));
+
+        if (chunks.isEmpty())
+            ready.set (1);
+    }
+
+    bool isReady() const noexcept                   { return ready.get() != 0; }
+
+    /** Returns true if the file couldn't be read, in which case the index will
+        never be ready. */
+    bool hasFailed() const noexcept                 { return failed.get() != 0; }
+
+    /** Returns the proportion of the file that has been scanned. */
+    double getProgress() const noexcept
+    {
+        return chunks.size() > 0 ? numChunksDone.get() / (double) chunks.size() : 1.0;
+    }
+
+    //==============================================================================
+    int getNumRegions() const noexcept              { return isReady() ? regions.size() : 0; }
+
+    /** Returns a silent region, in seconds. */
+    Range<double> getRegion (int index) const noexcept
+    {
+        const Range<int64> r (regions[index]);
+        return Range<double> (r.getStart() / sampleRate, r.getEnd() / sampleRate);
+    }
+
+    /** Returns the index of the first region that ends after the given time, or
+        getNumRegions() if there isn't one. */
+    int getFirstRegionEndingAfter (double seconds) const noexcept
+    {
+        const int64 position = (int64) (seconds * sampleRate);
+        int low = 0, high = getNumRegions();
+
+        while (low < high)
+        {
+            const int mid = (low + high) / 2;
+
+            if (regions.getReference (mid).getEnd() <= position)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+
+        return low;
+    }
+
+    /** Returns the silent region that the time is in, or an empty range. */
+    Range<double> getRegionAt (double seconds) const noexcept
+    {
+        const int index = getFirstRegionEndingAfter (seconds);
+
+        if (index < getNumRegions())
+        {
+            const Range<double> region (getRegion (index));
+
+            if (region.getStart() <= seconds)
+                return region;
+        }
+
+        return Range<double>();
+    }
+
+    /** Fills the regions between two times, in the current colour. Only the
+        regions that can be seen are visited. */
+    void draw (Graphics& g, const Rectangle<int>& area, double startTime, double endTime) const
+    {
+        if (area.isEmpty() || endTime <= startTime)
+            return;
+
+        const double pixelsPerSecond = area.getWidth() / (endTime - startTime);
+
+        for (int i = getFirstRegionEndingAfter (startTime); i < getNumRegions(); ++i)
+        {
+            const Range<double> region (getRegion (i));
+
+            if (region.getStart() >= endTime)
+                break;
+
+            const float x1 = (float) (area.getX() + (jmax (region.getStart(), startTime) - startTime) * pixelsPerSecond);
+            const float x2 = (float) (area.getX() + (jmin (region.getEnd(), endTime) - startTime) * pixelsPerSecond);
+
+            g.fillRect (Rectangle<float> (x1, (float) area.getY(), jmax (1.0f, x2 - x1), (float) area.getHeight()));
+        }
+    }
+
+private:
+    friend class SilenceIndexCache;
+
+    enum
+    {
+        windowSize = 512,
+        windowsPerChunk = 512,
+        minSilenceMs = 500
+    };
+
+    struct Chunk
+    {
+        Chunk (int first, int num) : firstWindow (first), numWindows (num) {}
+
+        const int firstWindow, numWindows;
+    };
+
+    static float getThreshold() noexcept            { return Decibels::decibelsToGain (-60.0f); }
+
+    // Called once, by whichever job finishes the last chunk.
+    void buildRegions()
+    {
+        const int minWindows = jmax (1, (int) (sampleRate * minSilenceMs / 1000.0 / windowSize));
+        int runStart = -1;
+
+        for (int w = 0; w <= numWindows; ++w)
+        {
+            const bool silent = w < numWindows && silentWindows[w] != 0;
+
+            if (silent && runStart < 0)
+                runStart = w;
+
+            if (! silent && runStart >= 0)
+            {
+                if (w - runStart >= minWindows)
+                    regions.add (Range<int64> ((int64) runStart * windowSize,
+                                               jmin (length, (int64) w * windowSize)));
+                runStart = -1;
+            }
+        }
+
+        ready.set (1);
+    }
+
+    const double sampleRate;
+    const int64 length;
+    const int numWindows;
+    HeapBlock<uint8> silentWindows;
+    OwnedArray<Chunk> chunks;
+    Atomic<int> numChunksDone, ready, failed;
+    Array<Range<int64>> regions;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SilenceIndex)
+};
+
+//==============================================================================
+/*
+    Keeps the silence indexes of the last few files, keyed the same way as the
+    thumbnail cache, and scans new ones on a pool of background threads.
+    Like the chromagram jobs, each job reads its chunk through its own
+    uncached reader rather than the shared decoder.
+*/
+class SilenceIndexCache
+{
+public:
+    SilenceIndexCache (DecodedBlockCache& cacheToReadFrom, int maxFilesToKeep)
+       : blockCache (cacheToReadFrom),
+         maxFiles (maxFilesToKeep),
+         pool (jlimit (1, 4, SystemStats::getNumCpus() - 1))
+    {
+    }
+
+    ~SilenceIndexCache()
+    {
+        pool.removeAllJobs (true, 5000);
+    }
+
+    /** Returns the index for a file, starting its scan if it isn't already
+        known. Returns nullptr if the file can't be read. */
+    SilenceIndex::Ptr getIndexFor (const File& file, int64 hash)
+    {
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            if (entries.getReference (i).hash == hash)
+            {
+                // move it to the back, as the most recently used
+                const Entry entry (entries.removeAndReturn (i));
+                entries.add (entry);
+                return entry.index;
+            }
+        }
+
+        ScopedPointer<AudioFormatReader> reader (blockCache.createReaderFor (file));
+
+        if (reader == nullptr || reader->sampleRate <= 0.0)
+            return nullptr;
+
+        SilenceIndex::Ptr index (new SilenceIndex (reader->sampleRate, reader->lengthInSamples));
+
+        for (int i = 0; i < index->chunks.size(); ++i)
+            pool.addJob (new ChunkJob (blockCache, file, index, *index->chunks.getUnchecked (i)), true);
+
+        const Entry entry = { hash, index };
+        entries.add (entry);
+
+        while (entries.size() > maxFiles)
+            forget (entries.removeAndReturn (0).index);
+
+        return index;
+    }
+
+private:
+    //==============================================================================
+    class ChunkJob : public ThreadPoolJob
+    {
+    public:
+        ChunkJob (DecodedBlockCache& c, const File& f, SilenceIndex* i, SilenceIndex::Chunk& ch)
+            : ThreadPoolJob ("Silence scan"), blockCache (c), file (f), index (i), chunk (ch)
+        {
+        }
+
+        SilenceIndex* getIndex() const noexcept         { return index; }
+
+        JobStatus runJob() override
+        {
+            TRACE_SCOPE ("Silence scan chunk");
+
+            ScopedPointer<AudioFormatReader> reader (blockCache.createUncachedReaderFor (file));
+
+            if (reader == nullptr)
+            {
+                index->failed.set (1);
+                return jobHasFinished;
+            }
+
+            const int64 start = (int64) chunk.firstWindow * SilenceIndex::windowSize;
+            const int numSamples = (int) jmin ((int64) chunk.numWindows * SilenceIndex::windowSize,
+                                               reader->lengthInSamples - start);
+
+            AudioSampleBuffer samples ((int) reader->numChannels, numSamples);
+            reader->read (&samples, 0, numSamples, start, true, true);
+
+            const float threshold = SilenceIndex::getThreshold();
+
+            for (int i = 0; i < chunk.numWindows; ++i)
+            {
+                if (shouldExit())
+                    return jobHasFinished;
+
+                const int offset = i * SilenceIndex::windowSize;
+                const int num = jmin ((int) SilenceIndex::windowSize, numSamples - offset);
+                bool silent = true;
+
+                for (int ch = 0; ch < samples.getNumChannels() && silent; ++ch)
+                    silent = ! VectorOps::exceedsThreshold (samples.getReadPointer (ch, offset), num, threshold);
+
+                index->silentWindows[chunk.firstWindow + i] = (uint8) (silent ? 1 : 0);
+            }
+
+            if (++(index->numChunksDone) == index->chunks.size())
+                index->buildRegions();
+
+            return jobHasFinished;
+        }
+
+    private:
+        DecodedBlockCache& blockCache;
+        const File file;
+        const SilenceIndex::Ptr index;
+        SilenceIndex::Chunk& chunk;
+    };
+
+    struct Entry
+    {
+        int64 hash;
+        SilenceIndex::Ptr index;
+    };
+
+    // Cancels any jobs still scanning an index that has been dropped.
+    void forget (SilenceIndex* index)
+    {
+        for (int i = pool.getNumJobs(); --i >= 0;)
+            if (ChunkJob* job = dynamic_cast<ChunkJob*> (pool.getJob (i)))
+                if (job->getIndex() == index)
+                    pool.removeJob (job, true, 0);
+    }
+
+    //==============================================================================
+    DecodedBlockCache& blockCache;
+    const int maxFiles;
+    ThreadPool pool;
+    Array<Entry> entries;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SilenceIndexCache)
+};
+
+#endif  // SILENCEINDEX_H_INCLUDED
@@ -0,0 +1,146 @@
+#ifndef SILENCESKIPPINGAUDIOSOURCE_H_INCLUDED
+#define SILENCESKIPPINGAUDIOSOURCE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LoopingAudioSource.h"
+#include "SilenceIndex.h"
+
+//==============================================================================
+/*
+    Plays a LoopingAudioSource and, while skipping is on, jumps over the silent
+    regions in the current file's SilenceIndex.
+
+    After each block, the position the loop source has reached is looked up in
+    the index. If it's inside a silent region, the tail of the block is faded
+    out and a seek to just before the end of the region is handed to the loop
+    source, which makes it at the start of the next block. That block is faded
+    back in. A little of the silence is kept at each end, so that gaps get
+    shorter rather than disappearing.
+
+    The index is swapped under a SpinLock that the audio thread only ever
+    tries to take. If it can't, that block isn't checked.
+*/
+class SilenceSkippingAudioSource : public AudioSource
+{
+public:
+    SilenceSkippingAudioSource (LoopingAudioSource& loopToUse, AudioTransportSource& transportToUse)
+       : loop (loopToUse),
+         transport (transportToUse)
+    {
+    }
+
+    //==============================================================================
+    /** Sets the index for the file that's now playing, or nullptr for none. */
+    void setIndex (SilenceIndex* newIndex)
+    {
+        SilenceIndex::Ptr oldIndex (newIndex);
+
+        {
+            const SpinLock::ScopedLockType lock (indexLock);
+            std::swap (index, oldIndex);
+        }
+
+        // oldIndex is released here, on the message thread
+    }
+
+    void setEnabled (bool shouldSkip) noexcept      { enabled.set (shouldSkip ? 1 : 0); }
+    bool isEnabled() const noexcept                 { return enabled.get() != 0; }
+
+    /** Returns how many silent regions have been skipped. */
+    int getNumSkips() const noexcept                { return numSkips.get(); }
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double newSampleRate) override
+    {
+        loop.prepareToPlay (samplesPerBlockExpected, newSampleRate);
+        fadeLength = jmax (1, (int) (newSampleRate * fadeMs / 1000));
+        fadeInRemaining = 0;
+    }
+
+    void releaseResources() override
+    {
+        loop.releaseResources();
+    }
+
+    void getNextAudioBlock (const AudioSourceChannelInfo& info) override
+    {
+        loop.getNextAudioBlock (info);
+
+        if (fadeInRemaining > 0)
+            fadeIn (info);
+
+        if (! isEnabled() || ! transport.isPlaying())
+            return;
+
+        const double position = loop.getCurrentPosition();
+        const double target = findSkipTarget (position);
+
+        if (target <= position)
+            return;
+
+        const int numToFade = jmin (info.numSamples, fadeLength);
+        info.buffer->applyGainRamp (info.startSample + info.numSamples - numToFade, numToFade, 1.0f, 0.0f);
+
+        loop.setPosition (target);
+        fadeInRemaining = fadeLength;
+        ++numSkips;
+    }
+
+private:
+    //==============================================================================
+    enum
+    {
+        fadeMs = 10,
+        keptSilenceMs = 100     // at each end of a region
+    };
+
+    // Returns where to jump to, or 0 if the position isn't in a region that's
+    // worth skipping.
+    double findSkipTarget (double position)
+    {
+        const SpinLock::ScopedTryLockType lock (indexLock);
+
+        if (! lock.isLocked() || index == nullptr || ! index->isReady())
+            return 0.0;
+
+        const Range<double> region (index->getRegionAt (position));
+        const double kept = keptSilenceMs / 1000.0;
+        const double target = region.getEnd() - kept;
+
+        if (region.isEmpty() || position < region.getStart() + kept || position >= target)
+            return 0.0;
+
+        // a loop wraps before reaching the end of the region
+        const Range<double> loopRange (loop.getActiveLoopRange());
+
+        if (! loopRange.isEmpty() && position < loopRange.getEnd() && target >= loopRange.getEnd())
+            return 0.0;
+
+        return target;
+    }
+
+    void fadeIn (const AudioSourceChannelInfo& info)
+    {
+        const int num = jmin (info.numSamples, fadeInRemaining);
+        const float startGain = 1.0f - fadeInRemaining / (float) fadeLength;
+        const float endGain = 1.0f - (fadeInRemaining - num) / (float) fadeLength;
+
+        info.buffer->applyGainRamp (info.startSample, num, startGain, endGain);
+        fadeInRemaining -= num;
+    }
+
+    //==============================================================================
+    LoopingAudioSource& loop;
+    AudioTransportSource& transport;
+
+    SpinLock indexLock;
+    SilenceIndex::Ptr index;
+    Atomic<int> enabled, numSkips;
+
+    // only touched by the audio thread
+    int fadeLength = 1, fadeInRemaining = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SilenceSkippingAudioSource)
+};
+
+#endif  // SILENCESKIPPINGAUDIOSOURCE_H_INCLUDED
@@ -0,0 +1,97 @@
+#ifndef STARTUPPROFILER_H_INCLUDED
+#define STARTUPPROFILER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Records how long each phase of application startup takes, measured from the
+    call to JUCEApplication::initialise(), and writes a summary to the log once
+    the main window has painted its first frame.
+
+    Phases marked after the first paint (i.e. the deferred initialisation of the
+    audio device and format manager) are logged individually as they happen.
+*/
+class StartupProfiler
+{
+public:
+    static StartupProfiler& getInstance()
+    {
+        static StartupProfiler instance;
+        return instance;
+    }
+
+    void start()
+    {
+        startTicks = lastTicks = Time::getHighResolutionTicks();
+        phases.clear();
+        firstPaintDone = false;
+    }
+
+    void markPhase (const String& phaseName)
+    {
+        if (startTicks == 0)
+            return;
+
+        const int64 now = Time::getHighResolutionTicks();
+        const Phase phase = { phaseName, ticksToMs (now - lastTicks), ticksToMs (now - startTicks) };
+        lastTicks = now;
+
+        if (firstPaintDone)
+            Logger::writeToLog ("Deferred startup: " + describe (phase));
+        else
+            phases.add (phase);
+    }
+
+    /** Call this from the first paint() of the main content component. */
+    void firstFramePainted()
+    {
+        if (firstPaintDone)
+            return;
+
+        markPhase ("first paint");
+        firstPaintDone = true;
+
+        const double total = ticksToMs (lastTicks - startTicks);
+        String report ("Startup timings:");
+
+        for (int i = 0; i < phases.size(); ++i)
+            report << newLine << "  " << describe (phases.getReference (i));
+
+        report << newLine << "  first paint after " << String (total, 1) << " ms"
+               << (total <= targetFirstPaintMs ? " (within " : " (over ")
+               << String ((int) targetFirstPaintMs) << " ms target)";
+
+        Logger::writeToLog (report);
+    }
+
+    enum { targetFirstPaintMs = 100 };
+
+private:
+    StartupProfiler() {}
+
+    struct Phase
+    {
+        String name;
+        double durationMs, elapsedMs;
+    };
+
+    static double ticksToMs (int64 ticks)
+    {
+        return Time::highResolutionTicksToSeconds (ticks) * 1000.0;
+    }
+
+    static String describe (const Phase& phase)
+    {
+        return phase.name.paddedRight (' ', 24)
+                + String (phase.durationMs, 2) + " ms  (at " + String (phase.elapsedMs, 2) + " ms)";
+    }
+
+    int64 startTicks = 0, lastTicks = 0;
+    Array<Phase> phases;
+    bool firstPaintDone = false;
+
+    JUCE_DECLARE_NON_COPYABLE (StartupProfiler)
+};
+
+#endif  // STARTUPPROFILER_H_INCLUDED
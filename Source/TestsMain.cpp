@@ -0,0 +1,414 @@
+/*
+  ==============================================================================
+
+    The entry point of the tests build (Builds/Tests), which runs the headless
+    tests of the playback path. Only this build links AllocationCounter.cpp,
+    so only here are allocations inside audio callbacks counted.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "CommandLineHarness.h"
+#include "AudioRecorder.h"
+#include "PlayheadClock.h"
+#include "ParametricEq.h"
+
+using CommandLineHarness::getOptionValue;
+using CommandLineHarness::playThroughHeadlessDevice;
+
+//==============================================================================
+static bool writeGoldenFile (const File& file, const AudioSampleBuffer& output, double sampleRate)
+{
+    file.deleteFile();
+    ScopedPointer<FileOutputStream> stream (file.createOutputStream());
+
+    if (stream == nullptr)
+        return false;
+
+    // 32-bit WAVs are floating point, so the output is stored exactly
+    WavAudioFormat wavFormat;
+    ScopedPointer<AudioFormatWriter> writer (wavFormat.createWriterFor (stream, sampleRate,
+                                                                        (unsigned int) output.getNumChannels(),
+                                                                        32, StringPairArray(), 0));
+    if (writer == nullptr)
+        return false;
+
+    stream.release();   // the writer owns it now
+    return writer->writeFromAudioSampleBuffer (output, 0, output.getNumSamples());
+}
+
+// Returns the largest difference from the golden file, or a negative number
+// if it can't be read or is a different shape.
+static float compareWithGoldenFile (const File& file, const AudioSampleBuffer& output)
+{
+    WavAudioFormat wavFormat;
+    ScopedPointer<AudioFormatReader> reader (wavFormat.createReaderFor (file.createInputStream(), true));
+
+    if (reader == nullptr || (int) reader->numChannels != output.getNumChannels()
+         || reader->lengthInSamples != output.getNumSamples())
+        return -1.0f;
+
+    AudioSampleBuffer expected (output.getNumChannels(), output.getNumSamples());
+    reader->read (&expected, 0, expected.getNumSamples(), 0, true, true);
+
+    float maxDifference = 0.0f;
+
+    for (int ch = 0; ch < output.getNumChannels(); ++ch)
+        for (int i = 0; i < output.getNumSamples(); ++i)
+            maxDifference = jmax (maxDifference, std::abs (output.getSample (ch, i) - expected.getSample (ch, i)));
+
+    return maxDifference;
+}
+
+/*  Plays a file through the whole playback path on a HeadlessAudioDevice, as
+    fast as it will go, and reports how long the callbacks took:
+
+        --headless <file> [--rate 44100] [--block-size 512] [--seconds 10]
+                          [--write-golden <wav>] [--golden <wav>] [--strict]
+
+    The output can be saved as a golden file, or compared against one. The
+    run fails if it doesn't match, or with --strict, if any callback
+    allocated or blocked.
+*/
+static String runHeadlessCallbackTest (const StringArray& args, bool& passed)
+{
+    passed = false;
+
+    const File file (File::getCurrentWorkingDirectory().getChildFile (getOptionValue (args, "--headless", String())));
+    const double sampleRate = getOptionValue (args, "--rate", "44100").getDoubleValue();
+    const int blockSize = getOptionValue (args, "--block-size", "512").getIntValue();
+    const double seconds = getOptionValue (args, "--seconds", "10").getDoubleValue();
+
+    if (! file.existsAsFile() || sampleRate <= 0.0 || blockSize <= 0 || seconds <= 0.0)
+        return String ("headless error=bad_arguments") + newLine;
+
+    HeadlessAudioDevice device (sampleRate, blockSize);
+    AudioSampleBuffer output (2, (int) std::ceil (seconds * sampleRate / blockSize) * blockSize);
+
+    if (! playThroughHeadlessDevice (file, device, output))
+        return String ("headless error=cannot_open_file") + newLine;
+
+    String report (device.getReport());
+    passed = true;
+
+    if (args.contains ("--strict"))
+        passed = device.getNumBlocksAllocating() == 0 && device.getNumBlocksBlocking() == 0;
+
+    const String writeGolden (getOptionValue (args, "--write-golden", String()));
+
+    if (writeGolden.isNotEmpty())
+    {
+        const bool written = writeGoldenFile (File::getCurrentWorkingDirectory().getChildFile (writeGolden),
+                                              output, sampleRate);
+        report << " golden_written=" << (written ? "yes" : "no");
+        passed = passed && written;
+    }
+
+    const String golden (getOptionValue (args, "--golden", String()));
+
+    if (golden.isNotEmpty())
+    {
+        // about -100 dB, which allows for a different compiler's rounding
+        const float difference = compareWithGoldenFile (File::getCurrentWorkingDirectory().getChildFile (golden), output);
+        const bool matches = difference >= 0.0f && difference <= 1.0e-5f;
+
+        report << " golden_max_difference=" << (difference >= 0.0f ? String (difference) : String ("unreadable"))
+               << " golden=" << (matches ? "pass" : "fail");
+        passed = passed && matches;
+    }
+
+    return report + newLine;
+}
+
+//==============================================================================
+// Passes a device's input straight to an AudioRecorder, as the playback
+// callback does, and leaves the output silent.
+class RecorderCallback : public AudioIODeviceCallback
+{
+public:
+    RecorderCallback (AudioRecorder& recorderToFeed) : recorder (recorderToFeed) {}
+
+    void audioDeviceIOCallback (const float** inputs, int numInputs,
+                                float** outputs, int numOutputs, int numSamples) override
+    {
+        // refers to the device's channels rather than copying them
+        const AudioSampleBuffer input (const_cast<float**> (inputs), numInputs, numSamples);
+        recorder.pushInput (input, 0, numSamples);
+
+        for (int ch = 0; ch < numOutputs; ++ch)
+            FloatVectorOperations::clear (outputs[ch], numSamples);
+    }
+
+    void audioDeviceAboutToStart (AudioIODevice*) override  {}
+    void audioDeviceStopped() override                      {}
+
+private:
+    AudioRecorder& recorder;
+};
+
+// The process's peak resident memory in KB, or -1 where it isn't available.
+static int64 getPeakResidentKilobytes()
+{
+   #if JUCE_LINUX
+    struct rusage usage;
+
+    if (getrusage (RUSAGE_SELF, &usage) == 0)
+        return (int64) usage.ru_maxrss;
+   #endif
+
+    return -1;
+}
+
+/*  Records hours of a generated tone through AudioRecorder on a headless
+    device, faster than real time, and checks that the recorder's memory use
+    stays flat and that nothing is dropped:
+
+        --record-soak [--hours 2] [--speed 20] [--rate 48000] [--block-size 512]
+                      [--channels 2] [--strict]
+
+    Blocks are paced at --speed times real time, so the disk has a chance to
+    keep up, and the recording goes to a temporary file that's deleted after.
+    The peak resident memory is taken once the first minute has been recorded,
+    when every buffer has been allocated, and mustn't have grown by more than
+    1 MB by the end. A leak of even one small allocation per block would add
+    tens of MB over an hour.
+    The run fails if any block is dropped, if the file is missing samples, or
+    with --strict, if any callback allocated or blocked.
+*/
+static String runRecorderSoakTest (const StringArray& args, bool& passed)
+{
+    passed = false;
+
+    const double hours = getOptionValue (args, "--hours", "2").getDoubleValue();
+    const double speed = getOptionValue (args, "--speed", "20").getDoubleValue();
+    const double sampleRate = getOptionValue (args, "--rate", "48000").getDoubleValue();
+    const int blockSize = getOptionValue (args, "--block-size", "512").getIntValue();
+    const int numChannels = getOptionValue (args, "--channels", "2").getIntValue();
+
+    if (hours <= 0.0 || speed <= 0.0 || sampleRate <= 0.0 || blockSize <= 0 || numChannels <= 0)
+        return String ("record_soak error=bad_arguments") + newLine;
+
+    const TemporaryFile file (".wav");
+    AudioRecorder recorder;
+
+    if (! recorder.startRecording (file.getFile(), sampleRate, numChannels))
+        return String ("record_soak error=cannot_create_file") + newLine;
+
+    ToneGeneratorAudioSource tone;
+    tone.setFrequency (440.0);
+    tone.setAmplitude (0.25f);
+
+    HeadlessAudioDevice device (sampleRate, blockSize, 2, numChannels);
+    RecorderCallback callback (recorder);
+    device.setInputSource (&tone);
+    device.start (&callback);
+
+    // about an eighth of the recorder's FIFO per batch, so it never has to
+    // hold more than that between two chances for the disk to catch up
+    const int blocksPerBatch = jmax (1, 8192 / blockSize);
+    const int64 totalBlocks = (int64) (hours * 3600.0 * sampleRate / blockSize);
+    const int64 warmUpBlocks = jmin (totalBlocks, (int64) (60.0 * sampleRate / blockSize));
+    const double startMs = Time::getMillisecondCounterHiRes();
+
+    int64 memoryAfterWarmUp = -1, blocksAllocating = 0, blocksBlocking = 0;
+    double maxBlockUs = 0.0;
+
+    for (int64 done = 0; done < totalBlocks;)
+    {
+        const int num = (int) jmin ((int64) blocksPerBatch, totalBlocks - done);
+        device.render (num);
+        done += num;
+
+        blocksAllocating += device.getNumBlocksAllocating();
+        blocksBlocking += device.getNumBlocksBlocking();
+        maxBlockUs = jmax (maxBlockUs, device.getMaxBlockMicroseconds());
+        device.clearStatistics();
+
+        if (memoryAfterWarmUp < 0 && done >= warmUpBlocks)
+            memoryAfterWarmUp = getPeakResidentKilobytes();
+
+        const double dueMs = startMs + done * blockSize * 1000.0 / (sampleRate * speed);
+        const double aheadMs = dueMs - Time::getMillisecondCounterHiRes();
+
+        if (aheadMs >= 1.0)
+            Thread::sleep ((int) aheadMs);
+    }
+
+    const double seconds = (Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+    const int64 memoryAtEnd = getPeakResidentKilobytes();
+
+    device.stop();
+    recorder.stop();
+
+    const int64 samplesPushed = totalBlocks * blockSize;
+    const int numDropped = recorder.getNumBlocksDropped();
+
+    WavAudioFormat wavFormat;
+    ScopedPointer<AudioFormatReader> reader (wavFormat.createReaderFor (file.getFile().createInputStream(), true));
+    const int64 samplesInFile = reader != nullptr ? reader->lengthInSamples : -1;
+
+    const bool memoryMeasured = memoryAfterWarmUp >= 0 && memoryAtEnd >= 0;
+    const int64 growth = memoryMeasured ? memoryAtEnd - memoryAfterWarmUp : 0;
+
+    passed = numDropped == 0 && samplesInFile == samplesPushed && growth <= 1024;
+
+    if (args.contains ("--strict"))
+        passed = passed && blocksAllocating == 0 && blocksBlocking == 0;
+
+    String report;
+    report << "record_soak hours=" << String (hours, 2)
+           << " sample_rate=" << sampleRate
+           << " block_size=" << blockSize
+           << " channels=" << numChannels
+           << " realtime_factor=" << String (seconds > 0.0 ? samplesPushed / sampleRate / seconds : 0.0, 1)
+           << " max_block_us=" << String (maxBlockUs, 2)
+           << " samples_pushed=" << samplesPushed
+           << " samples_in_file=" << samplesInFile
+           << " blocks_dropped=" << numDropped
+           << " blocks_allocating=" << blocksAllocating
+           << " blocks_blocking=" << blocksBlocking;
+
+    if (memoryMeasured)
+        report << " peak_rss_kb_after_warm_up=" << memoryAfterWarmUp
+               << " peak_rss_kb_at_end=" << memoryAtEnd
+               << " rss_growth_kb=" << growth;
+    else
+        report << " (memory not measured)";
+
+    if (! HeadlessAudioDevice::isCountingAllocations())
+        report << " (allocations not measured)";
+
+    report << " result=" << (passed ? "pass" : "fail");
+    return report + newLine;
+}
+
+//==============================================================================
+/*  Plays a simulated device into a PlayheadClock and draws simulated frames
+    from it, to check the playhead error the settings panel shows:
+
+        --playhead [--minutes 10] [--rate 48000] [--block-size 512]
+
+    Blocks are due every block's worth of samples but arrive late. Most are
+    up to 0.5 ms late, and one in fifty is up to 3 ms late. Frames are drawn
+    at 60 Hz, each up to 1 ms late. Here the position that's really being
+    heard is known exactly, so each frame's drawn position is compared with
+    it. The error the clock measured against its own audio clock is compared
+    with it too. The run fails if any frame is drawn 5 ms or more away from
+    what's being heard, or if the measured error is ever more than 0.1 ms out.
+*/
+static String runPlayheadSimulation (const StringArray& args, bool& passed)
+{
+    passed = false;
+
+    const double minutes = getOptionValue (args, "--minutes", "10").getDoubleValue();
+    const double sampleRate = getOptionValue (args, "--rate", "48000").getDoubleValue();
+    const int blockSize = getOptionValue (args, "--block-size", "512").getIntValue();
+
+    if (minutes <= 0.0 || sampleRate <= 0.0 || blockSize <= 0)
+        return String ("playhead_sim error=bad_arguments") + newLine;
+
+    // as prepareToPlay() gives it: the output latency plus a block
+    const int latencySamples = 2 * blockSize;
+    const double latencySeconds = latencySamples / sampleRate;
+    const double blockSeconds = blockSize / sampleRate;
+    const double frameSeconds = 1.0 / 60.0;
+    const int64 startTicks = Time::getHighResolutionTicks();
+
+    PlayheadClock clock;
+    clock.prepare (sampleRate, latencySamples);
+    Random random (1);
+
+    int64 blockNumber = 0;
+    double nextBlockArrival = 0.0, nextFrameDue = frameSeconds;
+    int numFrames = 0;
+    double drawnErrorTotal = 0.0, drawnErrorMax = 0.0, maxDeviation = 0.0;
+
+    while (nextFrameDue < minutes * 60.0)
+    {
+        if (nextBlockArrival <= nextFrameDue)
+        {
+            clock.publishAt (startTicks + Time::secondsToHighResolutionTicks (nextBlockArrival),
+                             blockNumber * blockSeconds, 1.0, Range<double>(), blockSize);
+
+            ++blockNumber;
+            const double lateness = random.nextInt (50) == 0 ? 0.5 + 2.5 * random.nextDouble()
+                                                             : 0.5 * random.nextDouble();
+            nextBlockArrival = blockNumber * blockSeconds + lateness * 0.001;
+            continue;
+        }
+
+        const double frameTime = nextFrameDue + 0.001 * random.nextDouble();
+        const int64 frameTicks = startTicks + Time::secondsToHighResolutionTicks (frameTime);
+        nextFrameDue += frameSeconds;
+
+        // the first blocks' samples haven't reached the speakers yet
+        if (frameTime < latencySeconds + 2.0 * blockSeconds)
+            continue;
+
+        const double heard = frameTime - latencySeconds;
+        const double drawnErrorMs = std::abs (clock.getPositionAt (frameTicks) - heard) * 1000.0;
+        const double measuredErrorMs = clock.measureFrameAt (frameTicks);
+
+        ++numFrames;
+        drawnErrorTotal += drawnErrorMs;
+        drawnErrorMax = jmax (drawnErrorMax, drawnErrorMs);
+        maxDeviation = jmax (maxDeviation, std::abs (measuredErrorMs - drawnErrorMs));
+    }
+
+    passed = numFrames > 0 && drawnErrorMax < 5.0 && maxDeviation <= 0.1;
+
+    String report;
+    report << "playhead_sim minutes=" << String (minutes, 1)
+           << " sample_rate=" << sampleRate
+           << " block_size=" << blockSize
+           << " frames=" << numFrames
+           << " drawn_error_mean_ms=" << String (numFrames > 0 ? drawnErrorTotal / numFrames : 0.0, 3)
+           << " drawn_error_max_ms=" << String (drawnErrorMax, 3)
+           << " measured_error_max_ms=" << String (clock.getMaxErrorMs(), 3)
+           << " measurement_deviation_max_ms=" << String (maxDeviation, 3)
+           << " result=" << (passed ? "pass" : "fail");
+    return report + newLine;
+}
+
+//==============================================================================
+static const char* const usage =
+    "Usage: AudioThumbnailTests <test> [options]\n"
+    "\n"
+    "  --headless <file> [--rate 44100] [--block-size 512] [--seconds 10]\n"
+    "                    [--write-golden <wav>] [--golden <wav>] [--strict]\n"
+    "      play a file through the whole playback path on a headless device\n"
+    "  --record-soak [--hours 2] [--speed 20] [--rate 48000] [--block-size 512]\n"
+    "                [--channels 2] [--strict]\n"
+    "      record hours of input and check that memory stays flat\n"
+    "  --playhead [--minutes 10] [--rate 48000] [--block-size 512]\n"
+    "      check the playhead error against a simulated device\n"
+    "  --eq\n"
+    "      check the SSE EQ against the same bands run in series\n";
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the playback path is built from components, so it needs a message manager
+    ScopedJuceInitialiser_GUI juceInitialiser;
+
+    StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (CharPointer_UTF8 (argv[i]));
+
+    bool passed = false;
+
+    if (args.contains ("--headless"))
+        std::cout << runHeadlessCallbackTest (args, passed) << std::flush;
+    else if (args.contains ("--record-soak"))
+        std::cout << runRecorderSoakTest (args, passed) << std::flush;
+    else if (args.contains ("--playhead"))
+        std::cout << runPlayheadSimulation (args, passed) << std::flush;
+    else if (args.contains ("--eq"))
+        std::cout << ParametricEqProcessor::runEquivalenceTest (passed) << std::flush;
+    else
+        std::cerr << usage;
+
+    return passed ? 0 : 1;
+}
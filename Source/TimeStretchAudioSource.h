@@ -0,0 +1,539 @@
+#ifndef TIMESTRETCHAUDIOSOURCE_H_INCLUDED
+#define TIMESTRETCHAUDIOSOURCE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "VectorOps.h"
+
+//==============================================================================
+/*
+    Changes the playback speed of another AudioSource without changing its pitch.
+
+    The stretching is done with WSOLA (waveform-similarity overlap-add): frames of
+    the input are taken every (hop * speed) samples and overlap-added every hop
+    samples, with each frame's start nudged by up to a quarter frame so that it
+    lines up with the natural continuation of the previous one.
+
+    All of that work happens on a background thread which keeps a look-ahead FIFO
+    topped up, so getNextAudioBlock() only ever copies samples out of the FIFO and
+    its cost doesn't depend on the speed. At exactly 1x the stage is bypassed and
+    the input is pulled straight through on the audio thread.
+
+    Switching between the two doesn't lose or repeat any audio. On leaving 1x,
+    the block is still pulled straight through, and the render thread carries
+    on from the sample after it. Its first frame blends in from the input
+    instead of fading in from silence. On returning to 1x, the render thread
+    blends its last frame back into the input. It then writes out the input it
+    had read ahead. The audio thread only starts pulling the input itself once
+    all of that has been played.
+*/
+class TimeStretchAudioSource : public AudioSource,
+                               private Thread
+{
+public:
+    TimeStretchAudioSource (AudioSource* inputSource,
+                            bool deleteInputWhenDeleted,
+                            int numChannelsToUse = 2)
+       : Thread ("Time stretch"),
+         input (inputSource, deleteInputWhenDeleted),
+         numChannels (numChannelsToUse),
+         fifo (1)
+    {
+        jassert (inputSource != nullptr);
+    }
+
+    ~TimeStretchAudioSource()
+    {
+        stopThread (1000);
+    }
+
+    //==============================================================================
+    /** Sets the playback speed, clipped to the 0.5x - 2x range. */
+    void setSpeed (double newSpeed) noexcept
+    {
+        speed.set ((float) jlimit (0.5, 2.0, newSpeed));
+    }
+
+    double getSpeed() const noexcept        { return speed.get(); }
+
+    bool isBypassed() const noexcept        { return rendering.get() == bypassing; }
+
+    /** Throws away the look-ahead. Call this after repositioning the input. */
+    void flush() noexcept
+    {
+        ++flushRequests;
+    }
+
+    /** Returns how far, in seconds of input, the input has been read ahead of what
+        is currently being heard. Subtract this from the input's position when
+        drawing a playhead.
+    */
+    double getLookAheadSeconds() const noexcept
+    {
+        if (isBypassed() || sampleRate <= 0.0)
+            return 0.0;
+
+        return (bufferedInputSamples.get() + fifo.getNumReady() * speed.get()) / sampleRate;
+    }
+
+    /** Returns the number of blocks that had to be padded with silence because the
+        background thread hadn't rendered enough. */
+    int getNumUnderruns() const noexcept    { return underruns.get(); }
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double newSampleRate) override
+    {
+        stopThread (1000);
+
+        input->prepareToPlay (samplesPerBlockExpected, newSampleRate);
+        sampleRate = newSampleRate;
+
+        frameSize = newSampleRate > 50000.0 ? 2048 : 1024;
+        hopSize = frameSize / 2;
+        tolerance = frameSize / 4;
+        pullSize = hopSize;
+
+        window.malloc ((size_t) frameSize);
+
+        for (int i = 0; i < frameSize; ++i)
+            window[i] = 0.5f - 0.5f * std::cos (2.0f * float_Pi * (float) i / (float) frameSize);
+
+        inputCapacity = 4 * frameSize + pullSize;
+        inputBuffer.setSize (numChannels, inputCapacity);
+        monoInput.malloc ((size_t) inputCapacity);
+        overlapBuffer.setSize (numChannels, frameSize);
+        scratch.malloc ((size_t) frameSize);
+
+        lookAhead = jmax (2 * hopSize, 2 * samplesPerBlockExpected);
+        fifo.setTotalSize (lookAhead + hopSize + 1);
+        fifoBuffer.setSize (numChannels, fifo.getTotalSize());
+
+        rendering.set (bypassing);
+        resetRenderState (false);
+
+        startThread (8);
+    }
+
+    void releaseResources() override
+    {
+        stopThread (1000);
+        input->releaseResources();
+    }
+
+    void getNextAudioBlock (const AudioSourceChannelInfo& info) override
+    {
+        const int flushes = flushRequests.get();
+        const bool flushRequested = (flushes != flushesHandled);
+        flushesHandled = flushes;
+
+        const bool atNormalSpeed = (speed.get() == 1.0f);
+        const int state = rendering.get();
+
+        // After a flush at 1x there's nothing worth keeping, so go straight
+        // back to the input.
+        if (state == bypassing || (flushRequested && atNormalSpeed))
+        {
+            if (state != bypassing)
+                stopRendering();
+
+            pullFromInput (info, 0);
+
+            if (! atNormalSpeed)
+            {
+                startRendering (true);
+                notify();
+            }
+
+            return;
+        }
+
+        if (flushRequested)
+            startRendering (false);
+        else if (state == stretching && atNormalSpeed)
+            rendering.set (draining);
+        else if (state == draining && ! atNormalSpeed)
+            rendering.set (stretching);
+
+        // Once the render thread has drained, the FIFO holds the last of the
+        // input it read, so the rest of the block can come from the input.
+        const bool handedBack = (rendering.get() == draining && drained.get() != 0);
+        const int numRead = readFromFifo (info);
+
+        if (numRead < info.numSamples)
+        {
+            if (handedBack)
+            {
+                stopRendering();
+                pullFromInput (info, numRead);
+            }
+            else
+            {
+                info.buffer->clear (info.startSample + numRead, info.numSamples - numRead);
+                ++underruns;
+            }
+        }
+
+        notify();
+    }
+
+private:
+    //==============================================================================
+    enum { bypassing = 0, stretching, draining };
+
+    // If continuingFromInput is true, the output so far was pulled straight
+    // from the input, and the first frame blends in from it.
+    void startRendering (bool continuingFromInput) noexcept
+    {
+        fifo.finishedRead (fifo.getNumReady());
+        continuesFromInput.set (continuingFromInput ? 1 : 0);
+        ++renderGeneration;
+        rendering.set (stretching);
+    }
+
+    void stopRendering() noexcept
+    {
+        rendering.set (bypassing);
+        ++renderGeneration;
+        fifo.finishedRead (fifo.getNumReady());
+    }
+
+    void pullFromInput (const AudioSourceChannelInfo& info, int offset) noexcept
+    {
+        const AudioSourceChannelInfo rest (info.buffer, info.startSample + offset, info.numSamples - offset);
+
+        // The render thread holds this while it's pulling from the input, which
+        // it can only be doing for a moment after we've switched to bypass.
+        const SpinLock::ScopedTryLockType lock (inputLock);
+
+        if (lock.isLocked())
+            input->getNextAudioBlock (rest);
+        else
+            rest.clearActiveBufferRegion();
+    }
+
+    // Returns the number of samples read, which is less than asked for if the
+    // FIFO ran out.
+    int readFromFifo (const AudioSourceChannelInfo& info) noexcept
+    {
+        const int numToRead = jmin (info.numSamples, fifo.getNumReady());
+        const int numDestChannels = info.buffer->getNumChannels();
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (numToRead, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < numDestChannels; ++ch)
+        {
+            const int sourceChannel = ch % numChannels;
+
+            if (size1 > 0)
+                info.buffer->copyFrom (ch, info.startSample, fifoBuffer, sourceChannel, start1, size1);
+
+            if (size2 > 0)
+                info.buffer->copyFrom (ch, info.startSample + size1, fifoBuffer, sourceChannel, start2, size2);
+        }
+
+        fifo.finishedRead (size1 + size2);
+        return size1 + size2;
+    }
+
+    //==============================================================================
+    void run() override
+    {
+        int generation = -1;
+
+        while (! threadShouldExit())
+        {
+            const int state = rendering.get();
+
+            if (state == bypassing)
+            {
+                wait (10);
+                continue;
+            }
+
+            if (generation != renderGeneration.get())
+            {
+                generation = renderGeneration.get();
+                resetRenderState (continuesFromInput.get() != 0);
+            }
+
+            if ((state == draining && drained.get() != 0)
+                 || fifo.getNumReady() >= lookAhead || fifo.getFreeSpace() < hopSize)
+            {
+                wait (5);
+                continue;
+            }
+
+            const SpinLock::ScopedLockType lock (inputLock);
+
+            if (rendering.get() == stretching)
+            {
+                // Cleared before looking again, so that if the audio thread
+                // switches to draining and still sees it set, we haven't read
+                // any more of the input.
+                drained.set (0);
+
+                if (rendering.get() == stretching)
+                {
+                    renderNextHop (generation);
+                    continue;
+                }
+            }
+
+            if (rendering.get() == draining)
+                drainNextHop (generation);
+        }
+    }
+
+    void resetRenderState (bool continuingFromInput)
+    {
+        inputStart = 0;
+        inputFill = 0;
+        analysisPosition = 0.0;
+        previousFrameStart = 0;
+        isFirstFrame = ! continuingFromInput;
+        passingThrough = continuingFromInput;
+        overlapBuffer.clear();
+        bufferedInputSamples.set (0);
+    }
+
+    // Makes sure the input buffer holds everything up to (but not including) endPosition,
+    // discarding anything before keepFrom if it needs to make room.
+    void pullInputUpTo (int64 endPosition, int64 keepFrom)
+    {
+        while (inputStart + inputFill < endPosition)
+        {
+            if (inputFill + pullSize > inputCapacity)
+                discardInputBefore (keepFrom);
+
+            jassert (inputFill + pullSize <= inputCapacity);
+
+            input->getNextAudioBlock (AudioSourceChannelInfo (&inputBuffer, inputFill, pullSize));
+
+            const float channelScale = 1.0f / (float) numChannels;
+            float* mono = monoInput + inputFill;
+
+            FloatVectorOperations::copyWithMultiply (mono, inputBuffer.getReadPointer (0, inputFill), channelScale, pullSize);
+
+            for (int ch = 1; ch < numChannels; ++ch)
+                FloatVectorOperations::addWithMultiply (mono, inputBuffer.getReadPointer (ch, inputFill), channelScale, pullSize);
+
+            inputFill += pullSize;
+        }
+    }
+
+    void discardInputBefore (int64 position)
+    {
+        const int numToDrop = (int) jlimit ((int64) 0, (int64) inputFill, position - inputStart);
+
+        if (numToDrop == 0)
+            return;
+
+        const int numToKeep = inputFill - numToDrop;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            FloatVectorOperations::copy (inputBuffer.getWritePointer (ch),
+                                         inputBuffer.getReadPointer (ch, numToDrop), numToKeep);
+
+        FloatVectorOperations::copy (monoInput, monoInput + numToDrop, numToKeep);
+
+        inputStart += numToDrop;
+        inputFill = numToKeep;
+    }
+
+    // Finds the frame start within [searchStart, searchEnd] whose first hop best
+    // matches the samples that followed the previous frame.
+    int64 findBestFrameStart (int64 target, int64 searchStart, int64 searchEnd) const noexcept
+    {
+        const float* reference = monoInput + (target - inputStart);
+
+        int64 best = searchStart;
+        float bestScore = -std::numeric_limits<float>::max();
+
+        // coarse pass every 4 samples, then refine around the winner
+        for (int64 candidate = searchStart; candidate <= searchEnd; candidate += 4)
+        {
+            const float score = VectorOps::dotProduct (reference, monoInput + (candidate - inputStart), hopSize);
+
+            if (score > bestScore)
+            {
+                bestScore = score;
+                best = candidate;
+            }
+        }
+
+        const int64 refineStart = jmax (searchStart, best - 3);
+        const int64 refineEnd = jmin (searchEnd, best + 3);
+
+        for (int64 candidate = refineStart; candidate <= refineEnd; ++candidate)
+        {
+            const float score = VectorOps::dotProduct (reference, monoInput + (candidate - inputStart), hopSize);
+
+            if (score > bestScore)
+            {
+                bestScore = score;
+                best = candidate;
+            }
+        }
+
+        return best;
+    }
+
+    void renderNextHop (int generation)
+    {
+        const float currentSpeed = speed.get();
+        const int64 nominalStart = (int64) (analysisPosition + 0.5);
+        int64 frameStart = nominalStart;
+
+        // The output so far has been the input itself, up to analysisPosition,
+        // so carry on as if a frame had just ended there.
+        if (passingThrough)
+        {
+            previousFrameStart = nominalStart - hopSize;
+            isFirstFrame = false;
+        }
+
+        if (isFirstFrame)
+        {
+            pullInputUpTo (nominalStart + frameSize, nominalStart);
+        }
+        else
+        {
+            const int64 target = previousFrameStart + hopSize;
+            const int64 searchStart = jmax (inputStart, nominalStart - tolerance);
+            const int64 searchEnd = nominalStart + tolerance;
+
+            pullInputUpTo (jmax (searchEnd, target) + frameSize, jmin (target, searchStart));
+            frameStart = findBestFrameStart (target, searchStart, searchEnd);
+
+            // That frame's fading tail, which this frame's first hop completes
+            if (passingThrough)
+            {
+                for (int ch = 0; ch < numChannels; ++ch)
+                    FloatVectorOperations::multiply (overlapBuffer.getWritePointer (ch),
+                                                     inputBuffer.getReadPointer (ch, (int) (target - inputStart)),
+                                                     window + hopSize, hopSize);
+
+                passingThrough = false;
+            }
+        }
+
+        const int offset = (int) (frameStart - inputStart);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            FloatVectorOperations::multiply (scratch, inputBuffer.getReadPointer (ch, offset), window, frameSize);
+            FloatVectorOperations::add (overlapBuffer.getWritePointer (ch), scratch, frameSize);
+        }
+
+        previousFrameStart = frameStart;
+        analysisPosition += hopSize * currentSpeed;
+        isFirstFrame = false;
+
+        bufferedInputSamples.set ((int) (inputStart + inputFill - (int64) analysisPosition));
+
+        // A flush or bypass may have happened while we were working; if so this hop
+        // belongs to the old position and must not reach the FIFO.
+        if (generation == renderGeneration.get())
+            writeToFifo (overlapBuffer, 0, hopSize);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* overlap = overlapBuffer.getWritePointer (ch);
+            FloatVectorOperations::copy (overlap, overlap + hopSize, frameSize - hopSize);
+            FloatVectorOperations::clear (overlap + frameSize - hopSize, hopSize);
+        }
+    }
+
+    // Back at 1x: finishes the last frame by blending it into the input that
+    // follows it, then writes out the rest of the input that's been read, a hop
+    // at a time. Once that's all in the FIFO, the input is handed back.
+    void drainNextHop (int generation)
+    {
+        if (! passingThrough)
+        {
+            if (! isFirstFrame)
+            {
+                // a Hann window's two halves add up to one, so this hop is the input itself
+                const int64 target = previousFrameStart + hopSize;
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                {
+                    FloatVectorOperations::multiply (scratch, inputBuffer.getReadPointer (ch, (int) (target - inputStart)),
+                                                     window, hopSize);
+                    FloatVectorOperations::add (overlapBuffer.getWritePointer (ch), scratch, hopSize);
+                }
+
+                if (generation == renderGeneration.get())
+                    writeToFifo (overlapBuffer, 0, hopSize);
+
+                analysisPosition = (double) (target + hopSize);
+                overlapBuffer.clear();
+            }
+
+            passingThrough = true;
+            isFirstFrame = false;
+        }
+        else
+        {
+            const int64 position = (int64) analysisPosition;
+            const int num = (int) jmin ((int64) hopSize, inputStart + inputFill - position);
+
+            if (num > 0 && generation == renderGeneration.get())
+                writeToFifo (inputBuffer, (int) (position - inputStart), num);
+
+            analysisPosition += num;
+        }
+
+        bufferedInputSamples.set ((int) (inputStart + inputFill - (int64) analysisPosition));
+
+        if (inputStart + inputFill <= (int64) analysisPosition)
+            drained.set (1);
+    }
+
+    void writeToFifo (const AudioSampleBuffer& source, int sourceStart, int num) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (num, start1, size1, start2, size2);
+        jassert (size1 + size2 == num);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if (size1 > 0)
+                fifoBuffer.copyFrom (ch, start1, source, ch, sourceStart, size1);
+
+            if (size2 > 0)
+                fifoBuffer.copyFrom (ch, start2, source, ch, sourceStart + size1, size2);
+        }
+
+        fifo.finishedWrite (size1 + size2);
+    }
+
+    //==============================================================================
+    OptionalScopedPointer<AudioSource> input;
+    const int numChannels;
+    double sampleRate = 0.0;
+
+    Atomic<float> speed { 1.0f };
+    Atomic<int> rendering, renderGeneration, flushRequests, underruns, bufferedInputSamples;
+    Atomic<int> continuesFromInput, drained;
+    int flushesHandled = 0;
+    SpinLock inputLock;
+
+    // look-ahead shared between the render thread and the audio thread
+    AbstractFifo fifo;
+    AudioSampleBuffer fifoBuffer;
+    int lookAhead = 0;
+
+    // render thread state
+    int frameSize = 0, hopSize = 0, tolerance = 0, pullSize = 0;
+    HeapBlock<float> window, monoInput, scratch;
+    AudioSampleBuffer inputBuffer, overlapBuffer;
+    int inputCapacity = 0, inputFill = 0;
+    int64 inputStart = 0, previousFrameStart = 0;
+    double analysisPosition = 0.0;
+    bool isFirstFrame = true, passingThrough = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TimeStretchAudioSource)
+};
+
+#endif  // TIMESTRETCHAUDIOSOURCE_H_INCLUDED
@@ -0,0 +1,270 @@
+#ifndef TRACER_H_INCLUDED
+#define TRACER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Records how long marked sections of code take on every thread, so that a
+    glitch can be traced back to whichever thread was busy at the time. The
+    recording is saved in the Chrome trace format, which chrome://tracing and
+    Perfetto can open.
+
+    A section is marked with TRACE_SCOPE ("name"), where the name is a string
+    literal. While tracing is off, that costs one atomic load and a branch.
+    While it's on, the section is timed and the event is added to a buffer
+    that belongs to the calling thread, so threads never wait for each other.
+    The first event on each thread allocates that thread's buffer; after that,
+    recording doesn't allocate or lock.
+
+    The audio thread mustn't allocate at all, so it calls setAudioThread() at
+    the top of each callback, and records into a buffer that start() allocates
+    on the message thread. Every audio thread shares that one buffer, so a new
+    thread after a device restart doesn't need another. Only one audio thread
+    runs at a time, so the buffer still has a single writer.
+
+    Each buffer is a ring holding the last bufferSize events. Older events are
+    overwritten rather than blocking, so a long recording keeps the most recent
+    part of each thread.
+*/
+class Tracer
+{
+public:
+    static Tracer& getInstance()
+    {
+        static Tracer instance;
+        return instance;
+    }
+
+    ~Tracer()
+    {
+        for (ThreadBuffer* b = buffers.get(); b != nullptr;)
+        {
+            ThreadBuffer* next = b->next;
+            delete b;
+            b = next;
+        }
+    }
+
+    //==============================================================================
+    /** Starts recording. Events from before this are left out of the next save. */
+    void start()
+    {
+        if (audioBuffer.get() == nullptr)
+            audioBuffer.set (createBuffer ("Audio thread"));
+
+        startTicks.set (Time::getHighResolutionTicks());
+        enabledFlag().set (1);
+    }
+
+    void stop()                                     { enabledFlag().set (0); }
+
+    static bool isEnabled() noexcept                { return enabledFlag().get() != 0; }
+
+    /** Marks the calling thread as the audio thread, so that its events go
+        into the buffer start() allocated. Call it from the audio callback,
+        before any TRACE_SCOPE there. It doesn't allocate or lock. */
+    static void setAudioThread() noexcept
+    {
+        isAudioThread() = true;
+    }
+
+    //==============================================================================
+    /** Times the section of code that it's in scope for. */
+    struct Scope
+    {
+        explicit Scope (const char* sectionName) noexcept
+            : name (sectionName),
+              start (isEnabled() ? Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~Scope() noexcept
+        {
+            if (start != 0)
+                if (ThreadBuffer* b = getBufferForThisThread())
+                    b->add (name, start, Time::getHighResolutionTicks());
+        }
+
+        const char* const name;
+        const int64 start;
+
+        JUCE_DECLARE_NON_COPYABLE (Scope)
+    };
+
+    //==============================================================================
+    /** Writes everything recorded since start() as Chrome trace JSON. This can be
+        called while tracing is still running. */
+    bool writeTo (const File& file) const
+    {
+        file.deleteFile();
+        ScopedPointer<FileOutputStream> out (file.createOutputStream());
+
+        if (out == nullptr)
+            return false;
+
+        const int64 origin = startTicks.get();
+        const double ticksPerMicrosecond = Time::getHighResolutionTicksPerSecond() / 1.0e6;
+        bool first = true;
+
+        *out << "{\"traceEvents\":[";
+
+        for (ThreadBuffer* b = buffers.get(); b != nullptr; b = b->next)
+        {
+            writeSeparator (*out, first);
+            *out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->index
+                 << ",\"args\":{\"name\":\"" << escape (b->name) << "\"}}";
+
+            Array<Event> events;
+            b->copyEvents (events);
+
+            for (int i = 0; i < events.size(); ++i)
+            {
+                const Event& e = events.getReference (i);
+
+                if (e.start < origin)
+                    continue;
+
+                writeSeparator (*out, first);
+                *out << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->index
+                     << ",\"ts\":" << String ((e.start - origin) / ticksPerMicrosecond, 3)
+                     << ",\"dur\":" << String ((e.end - e.start) / ticksPerMicrosecond, 3) << "}";
+            }
+        }
+
+        *out << "],\"displayTimeUnit\":\"ms\"}" << newLine;
+        out->flush();
+        return out->getStatus().wasOk();
+    }
+
+private:
+    //==============================================================================
+    enum { bufferSize = 1 << 15 };
+
+    struct Event
+    {
+        const char* name;
+        int64 start, end;
+    };
+
+    struct ThreadBuffer
+    {
+        ThreadBuffer (int threadIndex, const String& threadName)
+            : index (threadIndex), name (threadName), events ((size_t) bufferSize)
+        {
+        }
+
+        // only called by the owning thread
+        void add (const char* eventName, int64 start, int64 end) noexcept
+        {
+            const int64 n = numWritten.get();
+            Event& e = events[(size_t) (n & (bufferSize - 1))];
+            e.name = eventName;
+            e.start = start;
+            e.end = end;
+            numWritten.set (n + 1);
+        }
+
+        // Any event the owner overwrote while they were being copied is dropped,
+        // including the one in the slot it may be writing to right now.
+        void copyEvents (Array<Event>& result) const
+        {
+            const int64 before = numWritten.get();
+            const int64 first = jmax ((int64) 0, before - bufferSize);
+
+            for (int64 i = first; i < before; ++i)
+                result.add (events[(size_t) (i & (bufferSize - 1))]);
+
+            const int64 firstIntact = numWritten.get() - bufferSize + 1;
+
+            if (firstIntact > first)
+                result.removeRange (0, (int) (firstIntact - first));
+        }
+
+        const int index;
+        const String name;
+        HeapBlock<Event> events;
+        Atomic<int64> numWritten;
+        ThreadBuffer* next = nullptr;
+    };
+
+    Tracer() {}
+
+    static Atomic<int>& enabledFlag() noexcept
+    {
+        static Atomic<int> enabled;
+        return enabled;
+    }
+
+    static bool& isAudioThread() noexcept
+    {
+        static thread_local bool audioThread = false;
+        return audioThread;
+    }
+
+    // Returns nullptr on the audio thread if start() hasn't been called yet.
+    static ThreadBuffer* getBufferForThisThread() noexcept
+    {
+        static thread_local ThreadBuffer* buffer = nullptr;
+
+        if (buffer == nullptr)
+        {
+            Tracer& tracer = getInstance();
+            buffer = isAudioThread() ? tracer.audioBuffer.get()
+                                     : tracer.createBuffer (getCurrentThreadName());
+        }
+
+        return buffer;
+    }
+
+    static String getCurrentThreadName()
+    {
+        if (MessageManager::getInstanceWithoutCreating() != nullptr
+             && MessageManager::getInstance()->isThisTheMessageThread())
+            return "Message thread";
+
+        if (Thread* thread = Thread::getCurrentThread())
+            return thread->getThreadName();
+
+        return "Thread " + String::toHexString ((pointer_sized_int) Thread::getCurrentThreadId());
+    }
+
+    ThreadBuffer* createBuffer (const String& threadName)
+    {
+        ThreadBuffer* b = new ThreadBuffer (++numBuffers, threadName);
+
+        // push onto the front of the list
+        do
+        {
+            b->next = buffers.get();
+        }
+        while (! buffers.compareAndSetBool (b, b->next));
+
+        return b;
+    }
+
+    static void writeSeparator (OutputStream& out, bool& first)
+    {
+        if (! first)
+            out << ",";
+
+        first = false;
+    }
+
+    static String escape (const String& text)
+    {
+        return text.replace ("\\", "\\\\").replace ("\"", "\\\"");
+    }
+
+    //==============================================================================
+    Atomic<ThreadBuffer*> buffers, audioBuffer;
+    Atomic<int> numBuffers;
+    Atomic<int64> startTicks;
+
+    JUCE_DECLARE_NON_COPYABLE (Tracer)
+};
+
+/** Times the rest of the enclosing block under the given name (a string literal). */
+#define TRACE_SCOPE(name)   const Tracer::Scope JUCE_JOIN_MACRO (traceScope_, __LINE__) (name)
+
+#endif  // TRACER_H_INCLUDED
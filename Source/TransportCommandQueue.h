@@ -0,0 +1,282 @@
+#ifndef TRANSPORTCOMMANDQUEUE_H_INCLUDED
+#define TRANSPORTCOMMANDQUEUE_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Starts, stops and seeks playback at exact sample positions.
+
+    The message thread posts commands into a single-producer/single-consumer
+    FIFO. A command can take effect as soon as possible, or at a given value of
+    the device's sample clock (see getSampleClock()). process() is called at the
+    top of each audio block. It takes the new commands off the FIFO and keeps
+    them in the order they fall due, so one scheduled for later doesn't hold up
+    those posted after it. It then splits the block wherever a command falls,
+    pulls the playback source only for the parts where it's playing, and fades
+    over a few milliseconds either side of each start and stop. A stop pulls
+    only as far as the end of its fade, so playing again carries on from the
+    sample where the sound stopped, and a start or stop that arrives during a
+    fade turns it round from the gain it has reached.
+
+    The play state is published through an atomic for the message thread to
+    poll, so the UI doesn't have to wait for a change message to find out that
+    playback has started or stopped.
+*/
+class TransportCommandQueue
+{
+public:
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /** Called on the audio thread when a seek command takes effect. */
+        virtual void transportSeekRequested (double newPosition) = 0;
+    };
+
+    TransportCommandQueue()
+       : fifo (queueSize)
+    {
+    }
+
+    //==============================================================================
+    /** These post a command from the message thread. A time of -1 means at the
+        start of the next audio block. Returns false if the queue was full. */
+    bool start (int64 atSample = -1)                        { return post (Command::start, atSample); }
+    bool stop  (int64 atSample = -1)                        { return post (Command::stop, atSample); }
+    bool seek  (double newPosition, int64 atSample = -1)    { return post (Command::seek, atSample, newPosition); }
+
+    /** Returns the number of samples the device had played when the latest
+        block started. */
+    int64 getSampleClock() const noexcept       { return sampleClock.get(); }
+
+    /** True while the audio thread is playing the source, including the fade
+        after a stop. */
+    bool isPlaying() const noexcept             { return playing.get() != 0; }
+
+    //==============================================================================
+    void prepareToPlay (double newSampleRate)
+    {
+        fadeLength = jmax (1, (int) (newSampleRate * fadeMs / 1000));
+    }
+
+    /** Called on the audio thread. Fills the block from the source, applying any
+        commands that fall inside it. */
+    void process (const AudioSourceChannelInfo& info, AudioSource& source, Listener& listener)
+    {
+        const int64 blockStart = sampleClock.get();
+        int done = 0;
+
+        scheduleNewCommands (blockStart);
+
+        while (done < info.numSamples)
+        {
+            const int numUntilNextCommand = getSamplesUntilNextCommand (blockStart + done, info.numSamples - done);
+
+            if (numUntilNextCommand == 0)
+            {
+                applyNextCommand (listener);
+                continue;
+            }
+
+            renderSection (AudioSourceChannelInfo (info.buffer, info.startSample + done, numUntilNextCommand), source);
+            done += numUntilNextCommand;
+        }
+
+        sampleClock.set (blockStart + info.numSamples);
+    }
+
+    /** Called on the audio thread instead of process() while something else is
+        producing the audio. The clock keeps counting, and any commands that
+        fall due are applied at the start of the next process() call. */
+    void skip (int numSamples) noexcept
+    {
+        sampleClock.set (sampleClock.get() + numSamples);
+    }
+
+    /** Called on the audio thread when the source has stopped by itself, so
+        that the message thread sees playback stop. */
+    void sourceStopped() noexcept
+    {
+        gate = closed;
+        playing.set (0);
+    }
+
+private:
+    //==============================================================================
+    struct Command
+    {
+        enum Type { start, stop, seek };
+
+        Type type;
+        int64 atSample;
+        double position;
+    };
+
+    enum GateState { closed, opening, open, closing };
+
+    enum
+    {
+        queueSize = 64,
+        fadeMs = 3
+    };
+
+    bool post (Command::Type type, int64 atSample, double position = 0.0)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+            return false;
+
+        const Command command = { type, atSample, position };
+        commands[start1] = command;
+        fifo.finishedWrite (1);
+        return true;
+    }
+
+    // Moves whatever has been posted into the schedule, as long as there's room.
+    void scheduleNewCommands (int64 now) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (jmin (fifo.getNumReady(), (int) queueSize - numScheduled), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            schedule (commands[start1 + i], now);
+
+        for (int i = 0; i < size2; ++i)
+            schedule (commands[start2 + i], now);
+
+        fifo.finishedRead (size1 + size2);
+    }
+
+    // Inserts by due time. Commands due at the same sample stay in the order
+    // they were posted, and one that's immediate or already late is due now.
+    void schedule (Command command, int64 now) noexcept
+    {
+        command.atSample = jmax (command.atSample, now);
+        int i = numScheduled++;
+
+        for (; i > 0 && scheduled[i - 1].atSample > command.atSample; --i)
+            scheduled[i] = scheduled[i - 1];
+
+        scheduled[i] = command;
+    }
+
+    // Returns 0 if the next command is due now, otherwise how many samples
+    // can be rendered before it (at most maxSamples).
+    int getSamplesUntilNextCommand (int64 now, int maxSamples) const noexcept
+    {
+        if (numScheduled == 0)
+            return maxSamples;
+
+        return (int) jlimit ((int64) 0, (int64) maxSamples, scheduled[0].atSample - now);
+    }
+
+    void applyNextCommand (Listener& listener)
+    {
+        const Command command (scheduled[0]);
+
+        for (int i = 1; i < numScheduled; ++i)
+            scheduled[i - 1] = scheduled[i];
+
+        --numScheduled;
+
+        switch (command.type)
+        {
+            case Command::start:
+                if (gate == closed || gate == closing)
+                {
+                    // a stop that's still fading turns round from the gain it has reached
+                    fadePosition = gate == closing ? fadeLength - fadePosition : 0;
+                    gate = opening;
+                    playing.set (1);
+                }
+                break;
+
+            case Command::stop:
+                if (gate == open || gate == opening)
+                {
+                    fadePosition = gate == opening ? fadeLength - fadePosition : 0;
+                    gate = closing;
+                }
+                break;
+
+            case Command::seek:
+                listener.transportSeekRequested (command.position);
+                break;
+
+            default:
+                jassertfalse;
+                break;
+        }
+    }
+
+    void renderSection (const AudioSourceChannelInfo& info, AudioSource& source)
+    {
+        if (gate == closed)
+        {
+            info.clearActiveBufferRegion();
+            return;
+        }
+
+        if (gate == open)
+        {
+            source.getNextAudioBlock (info);
+            return;
+        }
+
+        // ramp over the fade, then leave the rest of the section alone (or silent)
+        const int numInFade = jmin (info.numSamples, fadeLength - fadePosition);
+        const float startGain = fadePosition / (float) fadeLength;
+        const float endGain = (fadePosition + numInFade) / (float) fadeLength;
+
+        if (gate == opening)
+        {
+            source.getNextAudioBlock (info);
+            info.buffer->applyGainRamp (info.startSample, numInFade, startGain, endGain);
+        }
+        else
+        {
+            // the source stops at the end of the fade, so a restart picks up from there
+            if (numInFade > 0)
+                source.getNextAudioBlock (AudioSourceChannelInfo (info.buffer, info.startSample, numInFade));
+
+            info.buffer->applyGainRamp (info.startSample, numInFade, 1.0f - startGain, 1.0f - endGain);
+        }
+
+        fadePosition += numInFade;
+
+        if (fadePosition < fadeLength)
+            return;
+
+        if (gate == opening)
+        {
+            gate = open;
+        }
+        else
+        {
+            gate = closed;
+            playing.set (0);
+            info.buffer->clear (info.startSample + numInFade, info.numSamples - numInFade);
+        }
+    }
+
+    //==============================================================================
+    AbstractFifo fifo;
+    Command commands[queueSize];
+
+    Atomic<int64> sampleClock;
+    Atomic<int> playing;
+
+    // only touched by the audio thread
+    Command scheduled[queueSize];       // taken off the FIFO, in the order they fall due
+    int numScheduled = 0;
+    GateState gate = closed;
+    int fadeLength = 1, fadePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TransportCommandQueue)
+};
+
+#endif  // TRANSPORTCOMMANDQUEUE_H_INCLUDED
@@ -0,0 +1,72 @@
+#ifndef VECTOROPS_H_INCLUDED
+#define VECTOROPS_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#endif
+
+//==============================================================================
+/*
+    A few hot inner loops that FloatVectorOperations doesn't cover, written with
+    SSE intrinsics on Intel and a plain loop everywhere else.
+*/
+namespace VectorOps
+{
+    /** Returns the sum of a[i] * b[i] over num samples. */
+    inline float dotProduct (const float* a, const float* b, int num) noexcept
+    {
+        float sum = 0.0f;
+        int i = 0;
+
+       #if JUCE_INTEL
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+
+        for (; i <= num - 8; i += 8)
+        {
+            acc0 = _mm_add_ps (acc0, _mm_mul_ps (_mm_loadu_ps (a + i),     _mm_loadu_ps (b + i)));
+            acc1 = _mm_add_ps (acc1, _mm_mul_ps (_mm_loadu_ps (a + i + 4), _mm_loadu_ps (b + i + 4)));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps (lanes, _mm_add_ps (acc0, acc1));
+        sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+       #endif
+
+        for (; i < num; ++i)
+            sum += a[i] * b[i];
+
+        return sum;
+    }
+
+    /** Returns true if any of the samples is louder than the threshold, either
+        side of zero. Stops at the first block of eight that has one. */
+    inline bool exceedsThreshold (const float* data, int num, float threshold) noexcept
+    {
+        int i = 0;
+
+       #if JUCE_INTEL
+        const __m128 limit = _mm_set1_ps (threshold);
+        const __m128 signBit = _mm_set1_ps (-0.0f);
+
+        for (; i <= num - 8; i += 8)
+        {
+            const __m128 a = _mm_andnot_ps (signBit, _mm_loadu_ps (data + i));
+            const __m128 b = _mm_andnot_ps (signBit, _mm_loadu_ps (data + i + 4));
+
+            if (_mm_movemask_ps (_mm_cmpgt_ps (_mm_max_ps (a, b), limit)) != 0)
+                return true;
+        }
+       #endif
+
+        for (; i < num; ++i)
+            if (std::abs (data[i]) > threshold)
+                return true;
+
+        return false;
+    }
+}
+
+#endif  // VECTOROPS_H_INCLUDED
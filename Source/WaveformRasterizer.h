@@ -0,0 +1,221 @@
+#ifndef WAVEFORMRASTERIZER_H_INCLUDED
+#define WAVEFORMRASTERIZER_H_INCLUDED
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/*
+    Draws an AudioThumbnail's channels the way AudioThumbnail::drawChannels()
+    does, but renders the columns into a single-channel Image and draws that
+    with one call, instead of filling a rectangle per pixel column.
+
+    The levels for every column are fetched first. They are turned into pixel
+    rows with vector operations, and each row of the image is then written in
+    a single branch-free pass over the columns. The image is kept, so a frame
+    showing the same part of the same thumbnail as the last one (the overview,
+    while nothing is loading) just draws it again. The thumbnail's hash code
+    is part of what's compared, so a different file of the same length that
+    comes back fully loaded from the thumbnail cache is still redrawn.
+
+    runBenchmark() times both ways of drawing at a range of widths.
+*/
+class WaveformRasterizer
+{
+public:
+    WaveformRasterizer() {}
+
+    /** Fills the area with the thumbnail's channels between two times, in the
+        graphics context's current colour. */
+    void draw (Graphics& g, const AudioThumbnail& thumbnail, const Rectangle<int>& area,
+               double startTime, double endTime, float verticalZoom)
+    {
+        if (area.isEmpty() || thumbnail.getNumChannels() == 0)
+            return;
+
+        const View view = { startTime, endTime, verticalZoom, area.getWidth(), area.getHeight(),
+                            thumbnail.getNumChannels(), thumbnail.getNumSamplesFinished(),
+                            thumbnail.getHashCode() };
+
+        if (image.isNull() || ! (view == lastView))
+        {
+            render (thumbnail, view);
+            lastView = view;
+        }
+
+        g.drawImageAt (image, area.getX(), area.getY(), true);
+    }
+
+    //==============================================================================
+    /** Times drawChannels() against draw() for a stereo five minute thumbnail,
+        drawing both the whole file and a two second window that moves on
+        each frame. The kept image is thrown away before each frame, so both
+        lines time a full render; the overview's "cached" line times the
+        frames that just draw the image again. Returns a line per width and
+        view. */
+    static String runBenchmark()
+    {
+        const double rate = 44100.0;
+        const int64 length = (int64) (rate * 300.0);
+        const int height = 200, numFrames = 50;
+
+        AudioFormatManager formatManager;
+        AudioThumbnailCache cache (1);
+        AudioThumbnail thumbnail (512, formatManager, cache);
+        thumbnail.reset (2, rate, length);
+
+        AudioSampleBuffer block (2, 65536);
+        Random random (1);
+
+        for (int64 pos = 0; pos < length; pos += block.getNumSamples())
+        {
+            // noise with a slow swell, so the columns vary in height
+            const float level = 0.2f + 0.7f * std::abs (std::sin ((float) pos / (float) rate));
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < block.getNumSamples(); ++i)
+                    block.setSample (ch, i, (random.nextFloat() * 2.0f - 1.0f) * level);
+
+            thumbnail.addBlock (pos, block, 0, (int) jmin ((int64) block.getNumSamples(), length - pos));
+        }
+
+        const int widths[] = { 600, 1280, 1920, 2560, 3840 };
+        String results;
+
+        for (int w = 0; w < numElementsInArray (widths); ++w)
+        {
+            Image target (Image::RGB, widths[w], height, true);
+            Graphics g (target);
+            g.setColour (Colours::red);
+
+            const Rectangle<int> area (0, 0, widths[w], height);
+            const double lengthInSeconds = thumbnail.getTotalLength();
+
+            for (int scrolling = 0; scrolling < 2; ++scrolling)
+            {
+                WaveformRasterizer rasterizer;
+                double seconds[3] = {};
+
+                // 0 = drawChannels(), 1 = draw() with nothing kept, 2 = draw() reusing the image
+                for (int method = 0; method < (scrolling != 0 ? 2 : 3); ++method)
+                {
+                    for (int frame = 0; frame < numFrames; ++frame)
+                    {
+                        const double start = scrolling != 0 ? frame * 0.1 : 0.0;
+                        const double end = scrolling != 0 ? start + 2.0 : lengthInSeconds;
+
+                        if (method == 1)
+                            rasterizer.lastView = View();
+
+                        const int64 startTicks = Time::getHighResolutionTicks();
+
+                        if (method == 0)
+                            thumbnail.drawChannels (g, area, start, end, 1.0f);
+                        else
+                            rasterizer.draw (g, thumbnail, area, start, end, 1.0f);
+
+                        seconds[method] += Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+                    }
+                }
+
+                for (int method = 1; method < (scrolling != 0 ? 2 : 3); ++method)
+                {
+                    results << "paint width=" << widths[w]
+                            << " view=" << (scrolling != 0 ? "scrolling" : (method == 1 ? "overview" : "overview-cached"))
+                            << " drawChannels_us=" << String (seconds[0] * 1.0e6 / numFrames, 1)
+                            << " rasterizer_us=" << String (seconds[method] * 1.0e6 / numFrames, 1)
+                            << " speedup=" << String (seconds[0] / jmax (1.0e-9, seconds[method]), 2)
+                            << newLine;
+                }
+            }
+        }
+
+        return results;
+    }
+
+private:
+    //==============================================================================
+    struct View
+    {
+        double startTime, endTime;
+        float verticalZoom;
+        int width, height, numChannels;
+        int64 numSamplesFinished, hashCode;
+
+        bool operator== (const View& other) const noexcept
+        {
+            return startTime == other.startTime && endTime == other.endTime
+                && verticalZoom == other.verticalZoom && width == other.width && height == other.height
+                && numChannels == other.numChannels && numSamplesFinished == other.numSamplesFinished
+                && hashCode == other.hashCode;
+        }
+    };
+
+    void render (const AudioThumbnail& thumbnail, const View& view)
+    {
+        const int width = view.width;
+
+        if (image.isNull() || image.getWidth() != width || image.getHeight() != view.height)
+        {
+            image = Image (Image::SingleChannel, width, view.height, false);
+            levels.malloc ((size_t) width * 2);
+            rows.malloc ((size_t) width * 2);
+        }
+
+        float* const minima = levels;
+        float* const maxima = levels + width;
+        int* const tops = rows;
+        int* const bottoms = rows + width;
+
+        const double secondsPerColumn = (view.endTime - view.startTime) / width;
+        const Image::BitmapData bitmap (image, Image::BitmapData::writeOnly);
+
+        // the channels are stacked, splitting the height as drawChannels() does
+        for (int channel = 0; channel < view.numChannels; ++channel)
+        {
+            const int y1 = roundToInt ((channel * view.height) / (double) view.numChannels);
+            const int y2 = roundToInt (((channel + 1) * view.height) / (double) view.numChannels);
+
+            for (int x = 0; x < width; ++x)
+            {
+                const double time = view.startTime + x * secondsPerColumn;
+                thumbnail.getApproximateMinMax (time, time + secondsPerColumn, channel, minima[x], maxima[x]);
+            }
+
+            // levels to rows, y = centre - level * halfHeight, with the top row
+            // included and the bottom one excluded
+            const float scale = -view.verticalZoom * (y2 - y1) * 0.5f;
+            const float centre = (y1 + y2) * 0.5f;
+
+            FloatVectorOperations::clip (maxima, maxima, -1.0f, 1.0f, width);
+            FloatVectorOperations::clip (minima, minima, -1.0f, 1.0f, width);
+            FloatVectorOperations::multiply (maxima, scale, width);
+            FloatVectorOperations::multiply (minima, scale, width);
+            FloatVectorOperations::add (maxima, centre, width);
+            FloatVectorOperations::add (minima, centre + 1.0f, width);
+
+            for (int x = 0; x < width; ++x)
+            {
+                tops[x] = (int) maxima[x];
+                bottoms[x] = jmax (tops[x] + 1, (int) minima[x]);
+            }
+
+            for (int y = y1; y < y2; ++y)
+            {
+                uint8* const line = bitmap.getLinePointer (y);
+
+                for (int x = 0; x < width; ++x)
+                    line[x] = (uint8) (-(int) ((y >= tops[x]) & (y < bottoms[x])));
+            }
+        }
+    }
+
+    //==============================================================================
+    Image image;
+    View lastView {};
+    HeapBlock<float> levels;
+    HeapBlock<int> rows;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformRasterizer)
+};
+
+#endif  // WAVEFORMRASTERIZER_H_INCLUDED